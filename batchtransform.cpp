@@ -0,0 +1,126 @@
+#include "batchtransform.h"
+#include "spankernel.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define XFORM_X86 1
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
+
+// Como em spankernel.cpp: GCC/Clang só aceitam intrínsecas AVX em funções
+// marcadas para o alvo. Sem "fma", para que mul + add não virem uma única
+// instrução com outro arredondamento.
+#if defined(XFORM_X86) && (defined(__GNUC__) || defined(__clang__))
+#define XFORM_TARGET_SSE2 __attribute__((target("sse2")))
+#define XFORM_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define XFORM_TARGET_SSE2
+#define XFORM_TARGET_AVX2
+#endif
+
+void transformPointsScalar(int* x, int* y, size_t n, const Mat3& M){
+    for(size_t i = 0; i < n; ++i){
+        double px = x[i], py = y[i];
+        double nx = M[0][0] * px + M[0][1] * py + M[0][2] * 1.0;
+        double ny = M[1][0] * px + M[1][1] * py + M[1][2] * 1.0;
+        x[i] = (int)std::round(nx);
+        y[i] = (int)std::round(ny);
+    }
+}
+
+#ifdef XFORM_X86
+
+// round() vetorial: t = trunc(v) e soma ±1 quando |v - t| >= 0.5. v - t é exato
+// (mesmo sinal e |t| >= |v|/2, ou t = 0), então bate com round() bit a bit.
+
+XFORM_TARGET_SSE2
+static inline __m128d roundHalfAwaySSE2(__m128d v){
+    const __m128d one = _mm_set1_pd(1.0);
+    __m128d t = _mm_cvtepi32_pd(_mm_cvttpd_epi32(v));
+    __m128d f = _mm_sub_pd(v, t);
+    __m128d up = _mm_and_pd(_mm_cmpge_pd(f, _mm_set1_pd(0.5)), one);
+    __m128d down = _mm_and_pd(_mm_cmple_pd(f, _mm_set1_pd(-0.5)), one);
+    return _mm_sub_pd(_mm_add_pd(t, up), down);
+}
+
+XFORM_TARGET_SSE2
+static void transformPointsSSE2(int* x, int* y, size_t n, const Mat3& M){
+    const __m128d m00 = _mm_set1_pd(M[0][0]), m01 = _mm_set1_pd(M[0][1]), m02 = _mm_set1_pd(M[0][2]);
+    const __m128d m10 = _mm_set1_pd(M[1][0]), m11 = _mm_set1_pd(M[1][1]), m12 = _mm_set1_pd(M[1][2]);
+    size_t i = 0;
+    for(; i + 2 <= n; i += 2){
+        __m128d px = _mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i*)(x + i)));
+        __m128d py = _mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i*)(y + i)));
+        // mesma ordem da versão escalar: (a*x + b*y) + c
+        __m128d nx = _mm_add_pd(_mm_add_pd(_mm_mul_pd(m00, px), _mm_mul_pd(m01, py)), m02);
+        __m128d ny = _mm_add_pd(_mm_add_pd(_mm_mul_pd(m10, px), _mm_mul_pd(m11, py)), m12);
+        _mm_storel_epi64((__m128i*)(x + i), _mm_cvttpd_epi32(roundHalfAwaySSE2(nx)));
+        _mm_storel_epi64((__m128i*)(y + i), _mm_cvttpd_epi32(roundHalfAwaySSE2(ny)));
+    }
+    transformPointsScalar(x + i, y + i, n - i, M);
+}
+
+XFORM_TARGET_AVX2
+static inline __m256d roundHalfAwayAVX2(__m256d v){
+    const __m256d one = _mm256_set1_pd(1.0);
+    __m256d t = _mm256_round_pd(v, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    __m256d f = _mm256_sub_pd(v, t);
+    __m256d up = _mm256_and_pd(_mm256_cmp_pd(f, _mm256_set1_pd(0.5), _CMP_GE_OQ), one);
+    __m256d down = _mm256_and_pd(_mm256_cmp_pd(f, _mm256_set1_pd(-0.5), _CMP_LE_OQ), one);
+    return _mm256_sub_pd(_mm256_add_pd(t, up), down);
+}
+
+// As sobras são feitas aqui em escalar (sem chamar a versão SSE2 com YMM sujo)
+XFORM_TARGET_AVX2
+static void transformPointsAVX2(int* x, int* y, size_t n, const Mat3& M){
+    const __m256d m00 = _mm256_set1_pd(M[0][0]), m01 = _mm256_set1_pd(M[0][1]), m02 = _mm256_set1_pd(M[0][2]);
+    const __m256d m10 = _mm256_set1_pd(M[1][0]), m11 = _mm256_set1_pd(M[1][1]), m12 = _mm256_set1_pd(M[1][2]);
+    size_t i = 0;
+    for(; i + 4 <= n; i += 4){
+        __m256d px = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*)(x + i)));
+        __m256d py = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*)(y + i)));
+        __m256d nx = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(m00, px), _mm256_mul_pd(m01, py)), m02);
+        __m256d ny = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(m10, px), _mm256_mul_pd(m11, py)), m12);
+        _mm_storeu_si128((__m128i*)(x + i), _mm256_cvttpd_epi32(roundHalfAwayAVX2(nx)));
+        _mm_storeu_si128((__m128i*)(y + i), _mm256_cvttpd_epi32(roundHalfAwayAVX2(ny)));
+    }
+    _mm256_zeroupper();
+    transformPointsScalar(x + i, y + i, n - i, M);
+}
+
+#endif // XFORM_X86
+
+// um bloco, no conjunto SIMD em uso
+static void transformChunk(int* x, int* y, size_t n, const Mat3& M){
+#ifdef XFORM_X86
+    switch(getSpanKernelISA()){
+    case SPAN_ISA_AVX2: transformPointsAVX2(x, y, n, M); return;
+    case SPAN_ISA_SSE2: transformPointsSSE2(x, y, n, M); return;
+    default: break;
+    }
+#endif
+    transformPointsScalar(x, y, n, M);
+}
+
+void transformPoints(int* x, int* y, size_t n, const Mat3& M){
+    // blocos de 64K vértices (512 KB de coordenadas) por tarefa
+    const size_t CHUNK = (size_t)1 << 16;
+    if(n <= CHUNK){
+        transformChunk(x, y, n, M);
+        return;
+    }
+    size_t chunks = (n + CHUNK - 1) / CHUNK;
+    parallelFor(chunks, [&](size_t c){
+        size_t first = c * CHUNK;
+        transformChunk(x + first, y + first, std::min(CHUNK, n - first), M);
+    });
+}
+
+void transformBatch(VertexSoA& buf, const Mat3& M, size_t first, size_t count){
+    if(first >= buf.size()) return;
+    count = std::min(count, buf.size() - first);
+    transformPoints(buf.x.data() + first, buf.y.data() + first, count, M);
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <vector>
+
+// Matriz 3x3 de transformação 2D em coordenadas homogêneas (x, y, 1).
+// A última linha é sempre [0, 0, 1] (transformações afins).
+using Mat3 = std::array<std::array<double, 3>, 3>;
+
+// Vértices inteiros em estrutura de arrays: x e y em vetores separados, para
+// que os kernels SIMD carreguem 2 (SSE2) ou 4 (AVX2) coordenadas de uma vez.
+// Várias formas podem dividir o mesmo buffer, cada uma num intervalo [first, first+n).
+struct VertexSoA {
+    std::vector<int> x, y;
+
+    size_t size() const { return x.size(); }
+    void clear(){ x.clear(); y.clear(); }
+    void reserve(size_t n){ x.reserve(n); y.reserve(n); }
+    size_t push(int px, int py){ x.push_back(px); y.push_back(py); return x.size() - 1; }
+};
+
+// Aplica M em lugar a n vértices (x[i], y[i]):
+//   x' = round(M[0][0]*x + M[0][1]*y + M[0][2]), y' = idem com a linha 1
+// com o mesmo arredondamento de round() (metade para longe do zero) e a mesma
+// ordem das operações em double da versão escalar, então o resultado é idêntico.
+// Usa o conjunto SIMD dos kernels de span (spankernel.h) e divide lotes grandes
+// entre as threads do pool.
+void transformPoints(int* x, int* y, size_t n, const Mat3& M);
+
+// idem para o intervalo [first, first+count) de buf (recortado ao tamanho)
+void transformBatch(VertexSoA& buf, const Mat3& M, size_t first = 0, size_t count = (size_t)-1);
+
+// versão escalar de referência (um ponto por vez)
+void transformPointsScalar(int* x, int* y, size_t n, const Mat3& M);
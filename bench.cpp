@@ -0,0 +1,532 @@
+#include "bench.h"
+#include "spankernel.h"
+#include "framebuffer.h"
+#include "fill.h"
+#include "batchtransform.h"
+#include "threadpool.h"
+#include "clipping.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+typedef std::chrono::steady_clock BenchClock;
+
+double secondsSince(BenchClock::time_point t0){
+    return std::chrono::duration<double>(BenchClock::now() - t0).count();
+}
+
+// caminho antigo: um pixel por vez, com teste de limites
+// (equivalente a setOverlayPixel em main.cpp)
+inline void setPixelChecked(Framebuffer& fb, int x, int y, Color c){
+    if(!fb.inside(x, y)) return;
+    fb.at(x, y) = c;
+}
+
+// executa fn(rowIndex, x0, x1) sobre spans de tamanho len até cobrir ~total pixels
+template <typename F>
+double timeSpans(int w, int h, int len, long long total, F fn){
+    long long done = 0;
+    auto t0 = BenchClock::now();
+    int y = 0, x = 0;
+    while(done < total){
+        int x1 = x + len - 1;
+        if(x1 >= w){ x = 0; x1 = len - 1; y = (y + 1) % h; }
+        fn(y, x, x1);
+        done += len;
+        x = x1 + 1;
+    }
+    double s = secondsSince(t0);
+    return s > 0 ? done / s : 0.0;
+}
+
+// Bresenham por pixel (mesmo laço de drawLineBresenham), gravando em fb
+void lineToBuffer(Framebuffer& fb, int x0, int y0, int x1, int y1, Color c){
+    bool steep = std::abs(y1 - y0) > std::abs(x1 - x0);
+    if(steep){ std::swap(x0, y0); std::swap(x1, y1); }
+    if(x0 > x1){ std::swap(x0, x1); std::swap(y0, y1); }
+    int dx = x1 - x0, dy = std::abs(y1 - y0), error = dx / 2;
+    int ystep = (y0 < y1) ? 1 : -1;
+    for(int x = x0, y = y0; x <= x1; ++x){
+        int px = steep ? y : x, py = steep ? x : y;
+        if(fb.inside(px, py)) fb.at(px, py) = c;
+        error -= dy;
+        if(error < 0){ y += ystep; error += dx; }
+    }
+}
+
+// idem, recortada a fb antes do laço (mesmo laço de bresenhamLine em main.cpp)
+void lineToBufferClipped(Framebuffer& fb, int x0, int y0, int x1, int y1, Color c){
+    BresenhamClip lc;
+    if(!clipBresenham(x0, y0, x1, y1, 0, 0, fb.width() - 1, fb.height() - 1, lc)) return;
+    int x = lc.x, y = lc.y, error = lc.err;
+    for(int i = 0; i < lc.count; ++i){
+        if(lc.steep) fb.at(y, x) = c; else fb.at(x, y) = c;
+        ++x;
+        error -= lc.dy;
+        if(error < 0){ y += lc.ystep; error += lc.dx; }
+    }
+}
+
+// idem, em trechos (rasterizeBresenham, como bresenhamLine em main.cpp)
+void lineToBufferRuns(Framebuffer& fb, int x0, int y0, int x1, int y1, Color c){
+    BresenhamClip lc;
+    if(!clipBresenham(x0, y0, x1, y1, 0, 0, fb.width() - 1, fb.height() - 1, lc)) return;
+    rasterizeBresenham(lc, [&](int y, int xa, int xb){
+        if(lc.steep) fb.fillColumn(y, xa, xb, c);
+        else fb.fillSpan(y, xa, xb, c);
+    }, [&](int y, int x){
+        if(lc.steep) fb.at(y, x) = c; else fb.at(x, y) = c;
+    });
+}
+
+// contorno do círculo ponto a ponto (laço de drawCircleBresenham antes dos
+// trechos por octante), gravando em fb
+void circlePointsToBuffer(Framebuffer& fb, int xc, int yc, int r, Color c){
+    int x = 0, y = r;
+    int d = 3 - 2 * r;
+    auto plot = [&](int px, int py){ if(fb.inside(px, py)) fb.at(px, py) = c; };
+    while(y >= x){
+        plot(xc + x, yc + y); plot(xc - x, yc + y); plot(xc + x, yc - y); plot(xc - x, yc - y);
+        plot(xc + y, yc + x); plot(xc - y, yc + x); plot(xc + y, yc - x); plot(xc - y, yc - x);
+        ++x;
+        if(d > 0){ --y; d = d + 4 * (x - y) + 10; }
+        else d = d + 4 * x + 6;
+    }
+}
+
+// corredores verticais de 3 pixels ligados alternadamente no topo e na base:
+// o flood fill percorre a imagem quase só na vertical
+void buildSerpentine(Framebuffer& fb){
+    const Color wall(0, 0, 0);
+    fb.clear(Color(255, 255, 255));
+    for(int x = 3, k = 0; x < fb.width(); x += 4, ++k){
+        int gapY = (k & 1) ? 0 : fb.height() - 1;
+        for(int y = 0; y < fb.height(); ++y)
+            if(y != gapY) fb.at(x, y) = wall;
+    }
+}
+
+// referência O(n) por segmento para PolygonWindow: todas as arestas e o teste
+// par-ímpar linear (o pointInPoly de bruteForceClipSegment) em cada intervalo
+size_t clipPolygonLinear(const std::vector<IPoint>& poly, const IPoint& a, const IPoint& b, SegmentSoA& out){
+    double ax = a.first, ay = a.second, dx = b.first - ax, dy = b.second - ay;
+    size_t n = poly.size();
+    auto inside = [&](double x, double y){
+        bool c = false;
+        for(size_t i = 0, j = n - 1; i < n; j = i++)
+            if(((poly[i].second > y) != (poly[j].second > y)) &&
+               (x < poly[i].first + (poly[j].first - poly[i].first) * (y - poly[i].second) / (double)(poly[j].second - poly[i].second)))
+                c = !c;
+        return c;
+    };
+    std::vector<double> ts(1, 0.0);
+    for(size_t i = 0, j = n - 1; i < n; j = i++){
+        double ex = poly[j].first - poly[i].first, ey = poly[j].second - poly[i].second;
+        double wx = poly[i].first - ax, wy = poly[i].second - ay;
+        double den = dx * ey - dy * ex;
+        if(den == 0) continue;
+        double tn = wx * ey - wy * ex, un = wx * dy - wy * dx;
+        if(den < 0){ den = -den; tn = -tn; un = -un; }
+        if(tn >= 0 && tn <= den && un >= 0 && un <= den) ts.push_back(tn / den);
+    }
+    ts.push_back(1.0);
+    std::sort(ts.begin(), ts.end());
+    size_t count = 0;
+    bool open = false;
+    double start = 0.0;
+    auto emit = [&](double tEnd){
+        out.push((int)std::round(ax + start * dx), (int)std::round(ay + start * dy),
+                 (int)std::round(ax + tEnd * dx), (int)std::round(ay + tEnd * dy));
+        ++count;
+    };
+    for(size_t i = 0; i + 1 < ts.size(); ++i){
+        if(ts[i + 1] == ts[i]) continue;
+        double mid = 0.5 * (ts[i] + ts[i + 1]);
+        bool in = inside(ax + mid * dx, ay + mid * dy);
+        if(in && !open){ open = true; start = ts[i]; }
+        else if(!in && open){ open = false; emit(ts[i]); }
+    }
+    if(open) emit(1.0);
+    return count;
+}
+
+double msSince(BenchClock::time_point t0){ return secondsSince(t0) * 1e3; }
+
+} // namespace
+
+void runSpanBenchmark(){
+    const int W = 1920, H = 1080;
+    const long long TOTAL = 200LL * W * H;
+    const int lens[] = {8, 64, 1920};
+    Framebuffer fb;
+    fb.resize(W, H, Color(255, 255, 255));
+
+    SpanKernelISA saved = getSpanKernelISA();
+    SpanKernelISA best = detectSpanKernelISA();
+    std::printf("== Benchmark de spans (%dx%d, %.0f Mpx por caso) ==\n", W, H, TOTAL / 1e6);
+    for(int len: lens){
+        const Color c(200, 200, 20);
+        double pp = timeSpans(W, H, len, TOTAL, [&](int y, int x0, int x1){
+            for(int x = x0; x <= x1; ++x) setPixelChecked(fb, x, y, c);
+        });
+        std::printf("span %4d px | por pixel          : %8.1f Mpx/s\n", len, pp / 1e6);
+        // kernels chamados direto: fillSpan escreve spans curtos sem o kernel,
+        // e a linha de 8 px mediria o mesmo laço para todos os conjuntos
+        uint32_t* px = reinterpret_cast<uint32_t*>(fb.data());
+        for(int isa = SPAN_ISA_SCALAR; isa <= best; ++isa){
+            setSpanKernelISA((SpanKernelISA)isa);
+            double k = timeSpans(W, H, len, TOTAL, [&](int y, int x0, int x1){
+                spanFill32(px + (size_t)y * W + x0, (size_t)(x1 - x0 + 1), c.packed());
+            });
+            std::printf("span %4d px | %-7s            : %8.1f Mpx/s (%.1fx)\n",
+                        len, spanKernelISAName((SpanKernelISA)isa), k / 1e6, pp > 0 ? k / pp : 0.0);
+        }
+        // o que os chamadores obtêm (recorte + caminho curto + melhor kernel)
+        setSpanKernelISA(best);
+        double fs = timeSpans(W, H, len, TOTAL, [&](int y, int x0, int x1){
+            fb.fillSpan(y, x0, x1, c);
+        });
+        std::printf("span %4d px | fillSpan           : %8.1f Mpx/s (%.1fx)\n",
+                    len, fs / 1e6, pp > 0 ? fs / pp : 0.0);
+    }
+    setSpanKernelISA(saved);
+    // evita que o compilador descarte as escritas
+    std::printf("(checksum %u)\n", (unsigned)(fb.at(3, 1).r + fb.at(11, 0).g));
+}
+
+void runLayoutBenchmark(){
+    const int W = 1920, H = 1080, REPS = 5;
+    const char* names[FB_LAYOUT_COUNT] = {"linear", "blocos 64x64"};
+    double serp[FB_LAYOUT_COUNT], open[FB_LAYOUT_COUNT], steep[FB_LAYOUT_COUNT];
+    unsigned checksum = 0;
+    for(int l = 0; l < FB_LAYOUT_COUNT; ++l){
+        Framebuffer fb;
+        fb.setLayout((FramebufferLayout)l);
+        fb.resize(W, H, Color(255, 255, 255));
+
+        serp[l] = open[l] = steep[l] = 0.0;
+        for(int rep = 0; rep < REPS; ++rep){
+            buildSerpentine(fb);
+            auto t0 = BenchClock::now();
+            floodFillBuffer(fb, 0, 0, Color(200, 200, 20));
+            serp[l] += msSince(t0);
+
+            fb.clear(Color(255, 255, 255));
+            t0 = BenchClock::now();
+            floodFillBuffer(fb, W / 2, H / 2, Color(20, 200, 200));
+            open[l] += msSince(t0);
+
+            // linhas íngremes: |dy| = H, |dx| <= 64
+            t0 = BenchClock::now();
+            for(int i = 0; i < 2000; ++i){
+                int x = (i * 37) % W;
+                lineToBuffer(fb, x, 0, x + (i % 129) - 64, H - 1, Color((uint8_t)i, 0, 0));
+            }
+            steep[l] += msSince(t0);
+        }
+        checksum += fb.at(5, 7).r + fb.at(W - 1, H - 1).g;
+    }
+    std::printf("== Benchmark de layout do framebuffer (%dx%d, %d repeticoes) ==\n", W, H, REPS);
+    for(int l = 0; l < FB_LAYOUT_COUNT; ++l){
+        std::printf("%-13s | flood corredores: %8.2f ms | flood aberto: %8.2f ms | linhas ingremes: %8.2f ms\n",
+                    names[l], serp[l] / REPS, open[l] / REPS, steep[l] / REPS);
+    }
+    std::printf("blocos/linear | %.2fx | %.2fx | %.2fx (checksum %u)\n",
+                serp[1] / serp[0], open[1] / open[0], steep[1] / steep[0], checksum);
+}
+
+void runTransformBenchmark(){
+    const size_t N = 1000000;
+    const int REPS = 10;
+    VertexSoA src;
+    src.reserve(N);
+    for(size_t i = 0; i < N; ++i) src.push(std::rand() % 4000 - 2000, std::rand() % 4000 - 2000);
+    // rotação de 30 graus em torno de (400, 300), composta à mão
+    const double a = 30.0 * 3.14159265358979323846 / 180.0, ca = std::cos(a), sa = std::sin(a);
+    const Mat3 M = {{{ca, -sa, 400 - 400 * ca + 300 * sa}, {sa, ca, 300 - 400 * sa - 300 * ca}, {0, 0, 1}}};
+
+    VertexSoA ref = src;
+    auto t0 = BenchClock::now();
+    for(int r = 0; r < REPS; ++r){
+        ref = src;
+        transformPointsScalar(ref.x.data(), ref.y.data(), N, M);
+    }
+    double scalarMs = msSince(t0) / REPS;
+    std::printf("== Transformacao em lote (%zu vertices SoA, %u threads) ==\n", N, threadPoolSize());
+    std::printf("escalar (1 thread)      : %7.2f ms (inclui copia)\n", scalarMs);
+
+    SpanKernelISA saved = getSpanKernelISA();
+    SpanKernelISA best = detectSpanKernelISA();
+    for(int isa = SPAN_ISA_SCALAR; isa <= best; ++isa){
+        setSpanKernelISA((SpanKernelISA)isa);
+        VertexSoA buf;
+        double ms = 0.0;
+        for(int r = 0; r < REPS; ++r){
+            buf = src;
+            t0 = BenchClock::now();
+            transformBatch(buf, M);
+            ms += msSince(t0);
+        }
+        bool same = buf.x == ref.x && buf.y == ref.y;
+        std::printf("%-7s em lote         : %7.2f ms (%s)\n", spanKernelISAName((SpanKernelISA)isa),
+                    ms / REPS, same ? "identico ao escalar" : "DIFERENTE");
+    }
+    setSpanKernelISA(saved);
+}
+
+void runClipBenchmark(){
+    const size_t N = 1000000;
+    const int REPS = 5;
+    const int XMIN = 0, YMIN = 0, XMAX = 799, YMAX = 599;
+    // cena bem maior que a janela: maioria fora, parte dentro e parte cruzando a borda
+    SegmentSoA src;
+    src.reserve(N);
+    for(size_t i = 0; i < N; ++i){
+        int x = std::rand() % 8000 - 4000, y = std::rand() % 6000 - 3000;
+        src.push(x, y, x + std::rand() % 201 - 100, y + std::rand() % 201 - 100);
+    }
+
+    SegmentSoA ref;
+    std::vector<uint32_t> refVisible;
+    auto t0 = BenchClock::now();
+    for(int r = 0; r < REPS; ++r){
+        ref = src;
+        refVisible.clear();
+        for(size_t k = 0; k < N; ++k)
+            if(cohenSutherlandClip(ref.x0[k], ref.y0[k], ref.x1[k], ref.y1[k], XMIN, YMIN, XMAX, YMAX))
+                refVisible.push_back((uint32_t)k);
+    }
+    double scalarMs = msSince(t0) / REPS;
+    std::printf("== Recorte de linhas (%zu segmentos, %zu visiveis, %u threads) ==\n", N, refVisible.size(), threadPoolSize());
+    std::printf("um a um                 : %7.2f ms (inclui copia)\n", scalarMs);
+
+    SpanKernelISA saved = getSpanKernelISA();
+    SpanKernelISA best = detectSpanKernelISA();
+    std::vector<uint32_t> visible;
+    for(int isa = SPAN_ISA_SCALAR; isa <= best; ++isa){
+        setSpanKernelISA((SpanKernelISA)isa);
+        SegmentSoA buf;
+        double ms = 0.0;
+        for(int r = 0; r < REPS; ++r){
+            buf = src;
+            t0 = BenchClock::now();
+            cohenSutherlandClipBatch(buf, XMIN, YMIN, XMAX, YMAX, visible);
+            ms += msSince(t0);
+        }
+        bool same = visible == refVisible && buf.x0 == ref.x0 && buf.y0 == ref.y0 && buf.x1 == ref.x1 && buf.y1 == ref.y1;
+        std::printf("%-7s em lote         : %7.2f ms (%s)\n", spanKernelISAName((SpanKernelISA)isa),
+                    ms / REPS, same ? "identico" : "DIFERENTE");
+    }
+    setSpanKernelISA(saved);
+
+    // janela convexa (octógono inscrito na viewport): cyrusBeckClip por segmento
+    // (refaz as normais a cada chamada) vs ClipWindow montado uma vez, em lote
+    std::vector<IPoint> octagon;
+    for(int i = 0; i < 8; ++i){
+        double ang = (i + 0.5) * 3.14159265358979323846 / 4;
+        octagon.push_back(IPoint((int)std::lround(400 + 290 * std::cos(ang)), (int)std::lround(300 + 290 * std::sin(ang))));
+    }
+    SegmentSoA cbRef = src;
+    std::vector<uint32_t> cbRefVisible;
+    t0 = BenchClock::now();
+    for(size_t k = 0; k < N; ++k){
+        IPoint a0, b0;
+        if(cyrusBeckClip(IPoint(cbRef.x0[k], cbRef.y0[k]), IPoint(cbRef.x1[k], cbRef.y1[k]), octagon, a0, b0)){
+            cbRef.x0[k] = a0.first; cbRef.y0[k] = a0.second;
+            cbRef.x1[k] = b0.first; cbRef.y1[k] = b0.second;
+            cbRefVisible.push_back((uint32_t)k);
+        }
+    }
+    double cbMs = msSince(t0);
+    ClipWindow window(octagon);
+    SegmentSoA cbBuf = src;
+    t0 = BenchClock::now();
+    window.clipBatch(cbBuf, visible);
+    double cwMs = msSince(t0);
+    bool cbSame = visible == cbRefVisible && cbBuf.x0 == cbRef.x0 && cbBuf.y0 == cbRef.y0 && cbBuf.x1 == cbRef.x1 && cbBuf.y1 == cbRef.y1;
+    std::printf("octogono: cyrusBeckClip %.2f ms, ClipWindow em lote %.2f ms (%s)\n", cbMs, cwMs, cbSame ? "identico" : "DIFERENTE");
+
+    // janela côncava tipo estêncil (estrela de 400 vértices) e traços que a
+    // atravessam: força bruta O(n) por segmento vs PolygonWindow preparada
+    std::vector<IPoint> star;
+    const int STAR = 400;
+    for(int i = 0; i < STAR; ++i){
+        double ang = i * 2 * 3.14159265358979323846 / STAR;
+        double rad = (i & 1) ? 120 : 290;
+        star.push_back(IPoint((int)std::lround(400 + rad * std::cos(ang)), (int)std::lround(300 + rad * std::sin(ang))));
+    }
+    const size_t STROKES = 20000;
+    SegmentSoA strokes;
+    strokes.reserve(STROKES);
+    for(size_t i = 0; i < STROKES; ++i){
+        int x = std::rand() % 800, y = std::rand() % 600;
+        strokes.push(x, y, x + std::rand() % 301 - 150, y + std::rand() % 301 - 150);
+    }
+    size_t firstOnly = 0;
+    t0 = BenchClock::now();
+    for(size_t k = 0; k < STROKES; ++k){
+        IPoint a0, b0;
+        if(bruteForceClipSegment(IPoint(strokes.x0[k], strokes.y0[k]), IPoint(strokes.x1[k], strokes.y1[k]), star, a0, b0)) ++firstOnly;
+    }
+    double bfMs = msSince(t0);
+    SegmentSoA linPieces;
+    std::vector<uint32_t> linSource;
+    t0 = BenchClock::now();
+    for(size_t k = 0; k < STROKES; ++k){
+        size_t got = clipPolygonLinear(star, IPoint(strokes.x0[k], strokes.y0[k]), IPoint(strokes.x1[k], strokes.y1[k]), linPieces);
+        linSource.insert(linSource.end(), got, (uint32_t)k);
+    }
+    double linMs = msSince(t0);
+    t0 = BenchClock::now();
+    PolygonWindow stencil(star);
+    double prepMs = msSince(t0);
+    SegmentSoA pieces;
+    std::vector<uint32_t> source;
+    t0 = BenchClock::now();
+    stencil.clipBatch(strokes, pieces, source);
+    double pwMs = msSince(t0);
+    bool pwSame = source == linSource && pieces.x0 == linPieces.x0 && pieces.y0 == linPieces.y0 &&
+                  pieces.x1 == linPieces.x1 && pieces.y1 == linPieces.y1;
+    std::printf("estrela %d vertices, %zu tracos: bruteForceClipSegment %.2f ms (%zu trechos, so o primeiro)\n",
+                STAR, STROKES, bfMs, firstOnly);
+    std::printf("  todos os trechos: O(n) %.2f ms, PolygonWindow %.2f ms + %.3f ms de preparo (%zu trechos, %s)\n",
+                linMs, pwMs, prepMs, source.size(), pwSame ? "identico" : "DIFERENTE");
+
+    // Bresenham: laço inteiro com teste por pixel vs recortado antes do laço
+    Framebuffer checked, clipped;
+    checked.resize(XMAX + 1, YMAX + 1, Color(255, 255, 255));
+    clipped.resize(XMAX + 1, YMAX + 1, Color(255, 255, 255));
+    t0 = BenchClock::now();
+    lineToBuffer(checked, -1000000, 0, 1000000, 10, Color(0, 0, 0));
+    double fullMs = msSince(t0);
+    t0 = BenchClock::now();
+    lineToBufferClipped(clipped, -1000000, 0, 1000000, 10, Color(0, 0, 0));
+    double clipMs = msSince(t0);
+    const int LINES = 20000;
+    for(int i = 0; i < LINES; ++i){
+        int range = (i & 1) ? 4000 : 400000; // metade longe da janela
+        int ax = std::rand() % range - range / 2 + 400, ay = std::rand() % range - range / 2 + 300;
+        int bx = std::rand() % range - range / 2 + 400, by = std::rand() % range - range / 2 + 300;
+        Color c((uint8_t)i, (uint8_t)(i >> 8), 0);
+        lineToBuffer(checked, ax, ay, bx, by, c);
+        lineToBufferClipped(clipped, ax, ay, bx, by, c);
+    }
+    std::vector<Color> a(checked.size()), b(clipped.size());
+    checked.copyToLinear(checked.bounds(), a.data(), checked.width());
+    clipped.copyToLinear(clipped.bounds(), b.data(), clipped.width());
+    std::printf("linha (-1e6,0)-(1e6,10): inteira %.3f ms, recortada %.4f ms (%d linhas aleatorias: %s)\n",
+                fullMs, clipMs, LINES, a == b ? "pixels identicos" : "DIFERENTES");
+}
+
+void runLineBenchmark(){
+    const int W = 1024, H = 768, LINES = 20000, REPS = 5;
+    Framebuffer perPixel, runs;
+    perPixel.resize(W, H, Color(255, 255, 255));
+    runs.resize(W, H, Color(255, 255, 255));
+    std::printf("== Bresenham por pixel vs em trechos (%d linhas) ==\n", LINES);
+    // inclinação máxima |dy|/|dx| (ou |dx|/|dy| nas íngremes) de cada grupo
+    struct Group { const char* name; int den; bool steep; };
+    const Group groups[] = {{"quase horizontais (1/64)", 64, false}, {"abertas (1/8)", 8, false},
+                            {"diagonais (1/1)", 1, false}, {"ingremes (1/8)", 8, true}};
+    bool allSame = true;
+    for(const Group &g: groups){
+        std::vector<int> seg;
+        for(int i = 0; i < LINES; ++i){
+            int len = 200 + std::rand() % 800;
+            int off = std::rand() % (2 * (len / g.den) + 1) - len / g.den;
+            int sign = (std::rand() & 1) ? 1 : -1; // os dois sentidos do eixo principal
+            int ax = std::rand() % W, ay = std::rand() % H;
+            if(g.steep){ seg.push_back(ax); seg.push_back(ay); seg.push_back(ax + off); seg.push_back(ay + sign * len); }
+            else { seg.push_back(ax); seg.push_back(ay); seg.push_back(ax + sign * len); seg.push_back(ay + off); }
+        }
+        double pixelMs = 0.0, runMs = 0.0;
+        for(int r = 0; r < REPS; ++r){
+            auto t0 = BenchClock::now();
+            for(size_t k = 0; k < seg.size(); k += 4)
+                lineToBufferClipped(perPixel, seg[k], seg[k + 1], seg[k + 2], seg[k + 3], Color((uint8_t)k, (uint8_t)(k >> 8), 0));
+            pixelMs += msSince(t0);
+            t0 = BenchClock::now();
+            for(size_t k = 0; k < seg.size(); k += 4)
+                lineToBufferRuns(runs, seg[k], seg[k + 1], seg[k + 2], seg[k + 3], Color((uint8_t)k, (uint8_t)(k >> 8), 0));
+            runMs += msSince(t0);
+        }
+        std::vector<Color> a(perPixel.size()), b(runs.size());
+        perPixel.copyToLinear(perPixel.bounds(), a.data(), W);
+        runs.copyToLinear(runs.bounds(), b.data(), W);
+        allSame = allSame && a == b;
+        std::printf("%-25s: por pixel %7.2f ms, em trechos %7.2f ms (%.1fx, %s)\n", g.name, pixelMs / REPS, runMs / REPS,
+                    pixelMs / runMs, a == b ? "pixels identicos" : "DIFERENTES");
+    }
+    // todos os octantes, inclusive linhas que saem da imagem
+    for(int i = 0; i < LINES * 10; ++i){
+        int ax = std::rand() % (3 * W) - W, ay = std::rand() % (3 * H) - H;
+        int bx = std::rand() % (3 * W) - W, by = std::rand() % (3 * H) - H;
+        Color c((uint8_t)i, (uint8_t)(i >> 8), (uint8_t)(i >> 16));
+        lineToBufferClipped(perPixel, ax, ay, bx, by, c);
+        lineToBufferRuns(runs, ax, ay, bx, by, c);
+    }
+    std::vector<Color> a(perPixel.size()), b(runs.size());
+    perPixel.copyToLinear(perPixel.bounds(), a.data(), W);
+    runs.copyToLinear(runs.bounds(), b.data(), W);
+    std::printf("%d linhas aleatorias (todos os octantes): %s\n", LINES * 10, a == b && allSame ? "pixels identicos" : "DIFERENTES");
+}
+
+void runCircleBenchmark(){
+    const int W = 1024, H = 768, CIRCLES = 20000;
+    const Color white(255, 255, 255), black(0, 0, 0), red(255, 0, 0);
+    Framebuffer points, runs;
+    points.resize(W, H, white);
+    runs.resize(W, H, white);
+    std::printf("== Circulos: contorno ponto a ponto vs em trechos; flood fill vs disco em spans ==\n");
+    std::vector<int> cs;
+    for(int i = 0; i < CIRCLES; ++i){
+        cs.push_back(std::rand() % (W + 400) - 200);
+        cs.push_back(std::rand() % (H + 400) - 200);
+        cs.push_back(std::rand() % 400);
+    }
+    auto t0 = BenchClock::now();
+    for(size_t k = 0; k < cs.size(); k += 3)
+        circlePointsToBuffer(points, cs[k], cs[k + 1], cs[k + 2], Color((uint8_t)k, (uint8_t)(k >> 8), 0));
+    double pointMs = msSince(t0);
+    t0 = BenchClock::now();
+    for(size_t k = 0; k < cs.size(); k += 3)
+        circleToBuffer(runs, cs[k], cs[k + 1], cs[k + 2], Color((uint8_t)k, (uint8_t)(k >> 8), 0));
+    double runMs = msSince(t0);
+    std::vector<Color> a(points.size()), b(runs.size());
+    points.copyToLinear(points.bounds(), a.data(), W);
+    runs.copyToLinear(runs.bounds(), b.data(), W);
+    std::printf("contorno (%d circulos): ponto a ponto %.2f ms, em trechos %.2f ms (%.1fx, %s)\n",
+                CIRCLES, pointMs, runMs, pointMs / runMs, a == b ? "pixels identicos" : "DIFERENTES");
+
+    // disco: contorno + flood fill a partir do centro vs spans; os pixels
+    // pintados (contorno ou preenchimento) devem ser exatamente os do disco
+    const int radii[] = {10, 50, 150, 350};
+    for(int r: radii){
+        const int REPS = 20;
+        int cx = W / 2, cy = H / 2;
+        double floodMs = 0.0, discMs = 0.0;
+        for(int rep = 0; rep < REPS; ++rep){
+            points.clear(white);
+            circleToBuffer(points, cx, cy, r, black);
+            t0 = BenchClock::now();
+            floodFillBuffer(points, cx, cy, red);
+            floodMs += msSince(t0);
+            runs.clear(white);
+            t0 = BenchClock::now();
+            discToBuffer(runs, cx, cy, r, red);
+            discMs += msSince(t0);
+        }
+        points.copyToLinear(points.bounds(), a.data(), W);
+        runs.copyToLinear(runs.bounds(), b.data(), W);
+        bool same = true;
+        for(size_t i = 0; i < a.size(); ++i)
+            same = same && ((a[i] != white) == (b[i] != white));
+        std::printf("disco r=%3d: flood fill %8.3f ms, spans %7.3f ms (%.0fx, %s)\n", r, floodMs / REPS, discMs / REPS,
+                    floodMs / discMs, same ? "pixels identicos" : "DIFERENTES");
+    }
+}
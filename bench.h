@@ -0,0 +1,30 @@
+#pragma once
+
+// Microbenchmarks dos kernels de rasterização (resultados no console).
+// Disparados pela tecla 'b' no programa.
+
+// vazão (pixels/s) do preenchimento de spans: laço por pixel vs kernels SIMD
+// (chamados direto) vs Framebuffer::fillSpan
+void runSpanBenchmark();
+
+// layout linear vs em blocos: flood fill (corredores verticais e área aberta) e
+// linhas íngremes
+void runLayoutBenchmark();
+
+// 1M vértices SoA sob uma Mat3: laço escalar vs kernels SSE2/AVX2 (com checagem
+// de que o arredondamento é idêntico)
+void runTransformBenchmark();
+
+// recorte de 1M segmentos contra a janela: cohenSutherlandClip um a um vs em
+// lote (outcodes SIMD), com checagem de resultado idêntico; Cyrus-Beck por
+// segmento vs ClipWindow; janela côncava: força bruta vs PolygonWindow (todos os
+// trechos); Bresenham com teste por pixel vs recortado antes do laço
+void runClipBenchmark();
+
+// Bresenham um pixel por iteração vs em trechos (run-slice), por faixa de
+// inclinação, com checagem de pixels idênticos em todos os octantes
+void runLineBenchmark();
+
+// círculos: contorno ponto a ponto vs em trechos por octante, e contorno +
+// flood fill vs disco em spans, com checagem de pixels idênticos
+void runCircleBenchmark();
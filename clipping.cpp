@@ -1,7 +1,24 @@
 #include "clipping.h"
+#include "spankernel.h"
+#include "threadpool.h"
 #include <cmath>
 #include <algorithm>
 
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CLIP_X86 1
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
+
+// como em spankernel.cpp: GCC/Clang só aceitam intrínsecas AVX2 em funções marcadas
+#if defined(CLIP_X86) && (defined(__GNUC__) || defined(__clang__))
+#define CLIP_TARGET_SSE2 __attribute__((target("sse2")))
+#define CLIP_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define CLIP_TARGET_SSE2
+#define CLIP_TARGET_AVX2
+#endif
+
 static int computeOutCode(int x, int y, int xmin, int ymin, int xmax, int ymax){
     int code = INSIDE;
     if(x < xmin) code |= LEFT;
@@ -49,6 +66,335 @@ bool cohenSutherlandClip(int &x0, int &y0, int &x1, int &y1, int xmin, int ymin,
     return accept;
 }
 
+// ------------------------
+// Bresenham recortado
+// ------------------------
+// No passo k (x = x0 + k) o laço já subiu m_k linhas e o erro vale
+//   err_k = h - k*dy + m_k*dx, com h = dx/2 e 0 <= err_k < dx,
+// logo m_k = ceil((k*dy - h) / dx). Como m_k não decresce, as faixas de y do
+// retângulo viram um intervalo de k, calculado com divisões inteiras em 64 bits.
+
+static long long bresenhamRise(long long k, long long dx, long long dy, long long h){
+    long long t = k * dy - h;
+    return t <= 0 ? 0 : (t + dx - 1) / dx;
+}
+
+bool clipBresenham(int x0, int y0, int x1, int y1, int xmin, int ymin, int xmax, int ymax, BresenhamClip& out){
+    out.count = 0;
+    out.steep = std::abs(y1 - y0) > std::abs(x1 - x0);
+    if(out.steep){
+        std::swap(x0, y0);
+        std::swap(x1, y1);
+        std::swap(xmin, ymin);
+        std::swap(xmax, ymax);
+    }
+    if(x0 > x1){
+        std::swap(x0, x1);
+        std::swap(y0, y1);
+    }
+    const long long dx = (long long)x1 - x0, dy = std::abs((long long)y1 - y0), h = dx / 2;
+    out.dx = (int)dx;
+    out.dy = (int)dy;
+    out.ystep = (y0 < y1) ? 1 : -1;
+
+    // passos cujo x está no retângulo
+    long long k0 = std::max(0LL, (long long)xmin - x0);
+    long long k1 = std::min(dx, (long long)xmax - x0);
+    // subidas m permitidas pelo intervalo de y: mLo <= m <= mHi
+    long long mLo, mHi;
+    if(out.ystep > 0){ mLo = (long long)ymin - y0; mHi = (long long)ymax - y0; }
+    else { mLo = (long long)y0 - ymax; mHi = (long long)y0 - ymin; }
+    // a linha sobe no máximo dy: limitar mantém os produtos abaixo de 2^62
+    mHi = std::min(mHi, dy);
+    if(mHi < 0 || mLo > dy) return false;
+    if(dy == 0){
+        if(mLo > 0) return false;
+    } else {
+        // primeiro k com m_k >= mLo e último com m_k <= mHi
+        if(mLo > 0) k0 = std::max(k0, ((mLo - 1) * dx + h) / dy + 1);
+        k1 = std::min(k1, (mHi * dx + h) / dy);
+    }
+    if(k0 > k1) return false;
+
+    long long m = dy == 0 ? 0 : bresenhamRise(k0, dx, dy, h);
+    out.x = (int)(x0 + k0);
+    out.y = (int)(y0 + out.ystep * m);
+    out.err = (int)(h - k0 * dy + m * dx);
+    out.count = (int)(k1 - k0 + 1);
+    return true;
+}
+
+// ------------------------
+// Cohen-Sutherland em lote
+// ------------------------
+
+namespace {
+
+struct ClipRect { int xmin, ymin, xmax, ymax; };
+
+// Decide os segmentos [first, first+n) a partir das máscaras de um grupo:
+// bit i de accept = ambos dentro; bit i de reject = fora do mesmo lado
+inline void resolveGroup(SegmentSoA& s, size_t first, int n, unsigned accept, unsigned reject,
+                         const ClipRect& r, std::vector<uint32_t>& visible){
+    for(int i = 0; i < n; ++i){
+        size_t k = first + i;
+        if(accept & (1u << i)){ visible.push_back((uint32_t)k); continue; }
+        if(reject & (1u << i)) continue;
+        if(cohenSutherlandClip(s.x0[k], s.y0[k], s.x1[k], s.y1[k], r.xmin, r.ymin, r.xmax, r.ymax))
+            visible.push_back((uint32_t)k);
+    }
+}
+
+void clipRangeScalar(SegmentSoA& s, size_t first, size_t last, const ClipRect& r, std::vector<uint32_t>& visible){
+    for(size_t k = first; k < last; ++k){
+        int c0 = computeOutCode(s.x0[k], s.y0[k], r.xmin, r.ymin, r.xmax, r.ymax);
+        int c1 = computeOutCode(s.x1[k], s.y1[k], r.xmin, r.ymin, r.xmax, r.ymax);
+        resolveGroup(s, k, 1, (c0 | c1) == 0, (c0 & c1) != 0, r, visible);
+    }
+}
+
+#ifdef CLIP_X86
+
+// outcode de 4 pontos (LEFT e RIGHT nunca valem juntos com xmin <= xmax, então
+// os dois testes independentes equivalem ao if/else de computeOutCode)
+CLIP_TARGET_SSE2
+inline __m128i outCodesSSE2(__m128i x, __m128i y, const ClipRect& r){
+    __m128i c = _mm_and_si128(_mm_cmplt_epi32(x, _mm_set1_epi32(r.xmin)), _mm_set1_epi32(LEFT));
+    c = _mm_or_si128(c, _mm_and_si128(_mm_cmpgt_epi32(x, _mm_set1_epi32(r.xmax)), _mm_set1_epi32(RIGHT)));
+    c = _mm_or_si128(c, _mm_and_si128(_mm_cmplt_epi32(y, _mm_set1_epi32(r.ymin)), _mm_set1_epi32(BOTTOM)));
+    c = _mm_or_si128(c, _mm_and_si128(_mm_cmpgt_epi32(y, _mm_set1_epi32(r.ymax)), _mm_set1_epi32(TOP)));
+    return c;
+}
+
+CLIP_TARGET_SSE2
+void clipRangeSSE2(SegmentSoA& s, size_t first, size_t last, const ClipRect& r, std::vector<uint32_t>& visible){
+    const __m128i zero = _mm_setzero_si128();
+    size_t k = first;
+    for(; k + 4 <= last; k += 4){
+        __m128i c0 = outCodesSSE2(_mm_loadu_si128((const __m128i*)(s.x0.data() + k)),
+                                  _mm_loadu_si128((const __m128i*)(s.y0.data() + k)), r);
+        __m128i c1 = outCodesSSE2(_mm_loadu_si128((const __m128i*)(s.x1.data() + k)),
+                                  _mm_loadu_si128((const __m128i*)(s.y1.data() + k)), r);
+        unsigned accept = (unsigned)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_or_si128(c0, c1), zero)));
+        unsigned reject = ~(unsigned)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(c0, c1), zero))) & 0xF;
+        if(reject == 0xF) continue; // o caso comum numa cena grande: tudo fora
+        if(accept == 0xF){
+            for(int i = 0; i < 4; ++i) visible.push_back((uint32_t)(k + i));
+            continue;
+        }
+        resolveGroup(s, k, 4, accept, reject, r, visible);
+    }
+    clipRangeScalar(s, k, last, r, visible);
+}
+
+CLIP_TARGET_AVX2
+inline __m256i outCodesAVX2(__m256i x, __m256i y, const ClipRect& r){
+    __m256i c = _mm256_and_si256(_mm256_cmpgt_epi32(_mm256_set1_epi32(r.xmin), x), _mm256_set1_epi32(LEFT));
+    c = _mm256_or_si256(c, _mm256_and_si256(_mm256_cmpgt_epi32(x, _mm256_set1_epi32(r.xmax)), _mm256_set1_epi32(RIGHT)));
+    c = _mm256_or_si256(c, _mm256_and_si256(_mm256_cmpgt_epi32(_mm256_set1_epi32(r.ymin), y), _mm256_set1_epi32(BOTTOM)));
+    c = _mm256_or_si256(c, _mm256_and_si256(_mm256_cmpgt_epi32(y, _mm256_set1_epi32(r.ymax)), _mm256_set1_epi32(TOP)));
+    return c;
+}
+
+// As sobras (e os segmentos ambíguos) são feitos em escalar; zeroupper antes de
+// sair do código AVX
+CLIP_TARGET_AVX2
+void clipRangeAVX2(SegmentSoA& s, size_t first, size_t last, const ClipRect& r, std::vector<uint32_t>& visible){
+    const __m256i zero = _mm256_setzero_si256();
+    size_t k = first;
+    for(; k + 8 <= last; k += 8){
+        __m256i c0 = outCodesAVX2(_mm256_loadu_si256((const __m256i*)(s.x0.data() + k)),
+                                  _mm256_loadu_si256((const __m256i*)(s.y0.data() + k)), r);
+        __m256i c1 = outCodesAVX2(_mm256_loadu_si256((const __m256i*)(s.x1.data() + k)),
+                                  _mm256_loadu_si256((const __m256i*)(s.y1.data() + k)), r);
+        unsigned accept = (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_or_si256(c0, c1), zero)));
+        unsigned reject = ~(unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(c0, c1), zero))) & 0xFF;
+        if(reject == 0xFF) continue;
+        if(accept == 0xFF){
+            for(int i = 0; i < 8; ++i) visible.push_back((uint32_t)(k + i));
+            continue;
+        }
+        _mm256_zeroupper();
+        resolveGroup(s, k, 8, accept, reject, r, visible);
+    }
+    _mm256_zeroupper();
+    clipRangeScalar(s, k, last, r, visible);
+}
+
+#endif // CLIP_X86
+
+void clipRange(SegmentSoA& s, size_t first, size_t last, const ClipRect& r, std::vector<uint32_t>& visible){
+#ifdef CLIP_X86
+    switch(getSpanKernelISA()){
+    case SPAN_ISA_AVX2: clipRangeAVX2(s, first, last, r, visible); return;
+    case SPAN_ISA_SSE2: clipRangeSSE2(s, first, last, r, visible); return;
+    default: break;
+    }
+#endif
+    clipRangeScalar(s, first, last, r, visible);
+}
+
+} // namespace
+
+// Executa range(first, last, lista) em blocos de 64K segmentos, um por tarefa do
+// pool, cada um com sua lista de visíveis; as listas são concatenadas em ordem
+template <typename F>
+static size_t clipInChunks(size_t n, std::vector<uint32_t>& visible, F range){
+    visible.clear();
+    const size_t CHUNK = (size_t)1 << 16;
+    if(n <= CHUNK){
+        range(0, n, visible);
+        return visible.size();
+    }
+    size_t chunks = (n + CHUNK - 1) / CHUNK;
+    static thread_local std::vector<std::vector<uint32_t>> partsLocal;
+    // o lambda não captura variáveis thread_local: sem esta referência cada
+    // worker usaria a sua própria cópia (vazia)
+    std::vector<std::vector<uint32_t>> &parts = partsLocal;
+    if(parts.size() < chunks) parts.resize(chunks);
+    parallelFor(chunks, [&](size_t c){
+        parts[c].clear();
+        range(c * CHUNK, std::min(n, (c + 1) * CHUNK), parts[c]);
+    });
+    size_t total = 0;
+    for(size_t c = 0; c < chunks; ++c) total += parts[c].size();
+    visible.reserve(total);
+    for(size_t c = 0; c < chunks; ++c) visible.insert(visible.end(), parts[c].begin(), parts[c].end());
+    return visible.size();
+}
+
+size_t cohenSutherlandClipBatch(SegmentSoA& segs, int xmin, int ymin, int xmax, int ymax, std::vector<uint32_t>& visible){
+    const ClipRect r = {xmin, ymin, xmax, ymax};
+    return clipInChunks(segs.size(), visible, [&](size_t first, size_t last, std::vector<uint32_t>& out){
+        clipRange(segs, first, last, r, out);
+    });
+}
+
+// ------------------------
+// Janela convexa (Cyrus-Beck)
+// ------------------------
+
+void ClipWindow::set(const std::vector<IPoint>& convexPoly){
+    m_edges.clear();
+    size_t n = convexPoly.size();
+    if(n < 3) return;
+    // área com sinal (shoelace): negativa = horário
+    long long area2 = 0;
+    for(size_t i = 0; i < n; ++i){
+        const IPoint &p = convexPoly[i], &q = convexPoly[(i + 1) % n];
+        area2 += (long long)p.first * q.second - (long long)q.first * p.second;
+    }
+    if(area2 == 0) return;
+    bool ccw = area2 > 0;
+    m_xmin = m_xmax = convexPoly[0].first;
+    m_ymin = m_ymax = convexPoly[0].second;
+    for(const IPoint &p: convexPoly){
+        m_xmin = std::min(m_xmin, p.first); m_xmax = std::max(m_xmax, p.first);
+        m_ymin = std::min(m_ymin, p.second); m_ymax = std::max(m_ymax, p.second);
+    }
+    for(size_t i = 0; i < n; ++i){
+        // percorre ao contrário quando horário, para todas as normais apontarem para fora
+        const IPoint &p0 = ccw ? convexPoly[i] : convexPoly[(n - i) % n];
+        const IPoint &p1 = ccw ? convexPoly[(i + 1) % n] : convexPoly[n - 1 - i];
+        double ex = p1.first - p0.first, ey = p1.second - p0.second;
+        if(ex == 0 && ey == 0) continue; // vértice repetido
+        Edge e;
+        e.nx = ey;
+        e.ny = -ex;
+        e.c = e.nx * p0.first + e.ny * p0.second;
+        m_edges.push_back(e);
+    }
+    if(m_edges.size() < 3) m_edges.clear();
+}
+
+bool ClipWindow::clipParams(double ax, double ay, double dx, double dy, double& tE, double& tL) const {
+    tE = 0.0; tL = 1.0;
+    for(const Edge &e: m_edges){
+        // dentro: n.P <= c; com P(t) = a + t*d fica t*(n.d) <= c - n.a
+        double num = e.c - (e.nx * ax + e.ny * ay);
+        double den = e.nx * dx + e.ny * dy;
+        if(std::fabs(den) < 1e-9){
+            if(num < 0) return false; // paralela e fora
+            continue;
+        }
+        double t = num / den;
+        if(den < 0){ if(t > tE) tE = t; } // entrando
+        else { if(t < tL) tL = t; }       // saindo
+        if(tE > tL) return false;
+    }
+    return true;
+}
+
+bool ClipWindow::clip(const IPoint &a, const IPoint &b, IPoint &outA, IPoint &outB) const {
+    if(m_edges.empty()) return false;
+    if(computeOutCode(a.first, a.second, m_xmin, m_ymin, m_xmax, m_ymax) &
+       computeOutCode(b.first, b.second, m_xmin, m_ymin, m_xmax, m_ymax)) return false;
+    double ax = a.first, ay = a.second, dx = b.first - ax, dy = b.second - ay;
+    double tE, tL;
+    if(!clipParams(ax, ay, dx, dy, tE, tL)) return false;
+    double bx = b.first, by = b.second;
+    outA.first = (int)std::round(ax + tE * (bx - ax)); outA.second = (int)std::round(ay + tE * (by - ay));
+    outB.first = (int)std::round(ax + tL * (bx - ax)); outB.second = (int)std::round(ay + tL * (by - ay));
+    return true;
+}
+
+size_t ClipWindow::clipBatch(SegmentSoA& segs, std::vector<uint32_t>& visible) const {
+    if(m_edges.empty()){
+        visible.clear();
+        return 0;
+    }
+    return clipInChunks(segs.size(), visible, [&](size_t first, size_t last, std::vector<uint32_t>& out){
+        for(size_t k = first; k < last; ++k){
+            IPoint a(segs.x0[k], segs.y0[k]), b(segs.x1[k], segs.y1[k]), ca, cb;
+            if(!clip(a, b, ca, cb)) continue;
+            segs.x0[k] = ca.first; segs.y0[k] = ca.second;
+            segs.x1[k] = cb.first; segs.y1[k] = cb.second;
+            out.push_back((uint32_t)k);
+        }
+    });
+}
+
+// ------------------------
+// Sutherland-Hodgman para preenchimento
+// ------------------------
+
+// Uma passada: mantém os vértices dentro do semiplano e, de cada sequência de
+// vértices fora, só a primeira e a última. Sem vértice dentro, out fica vazio.
+template <typename Outside>
+static void clipPolygonSide(const std::vector<IPoint>& in, std::vector<IPoint>& out, Outside outside){
+    out.clear();
+    size_t n = in.size();
+    size_t s = 0;
+    while(s < n && outside(in[s])) ++s;
+    if(s == n) return;
+    // começando num vértice de dentro, nenhuma sequência de fora dá a volta
+    bool prevOut = false;
+    for(size_t i = 0; i < n; ++i){
+        const IPoint &v = in[(s + i) % n];
+        bool vOut = outside(v);
+        bool nextOut = outside(in[(s + i + 1) % n]);
+        if(!vOut || !prevOut || !nextOut) out.push_back(v);
+        prevOut = vOut;
+    }
+}
+
+void clipPolygonForFill(const std::vector<IPoint>& poly, int xmin, int ymin, int xmax, int ymax,
+                        std::vector<IPoint>& out, std::vector<IPoint>& scratch){
+    out.clear();
+    if(poly.size() < 3) return;
+    // quatro passadas alternando os buffers: a última escreve em out, sem troca
+    clipPolygonSide(poly, scratch, [&](const IPoint &p){ return p.first < xmin; });
+    clipPolygonSide(scratch, out, [&](const IPoint &p){ return p.first > xmax; });
+    clipPolygonSide(out, scratch, [&](const IPoint &p){ return p.second < ymin; });
+    clipPolygonSide(scratch, out, [&](const IPoint &p){ return p.second > ymax; });
+    if(out.size() < 3) out.clear();
+}
+
+void clipPolygonForFill(const std::vector<IPoint>& poly, int xmin, int ymin, int xmax, int ymax, std::vector<IPoint>& out){
+    static thread_local std::vector<IPoint> tmp;
+    clipPolygonForFill(poly, xmin, ymin, xmax, ymax, out, tmp);
+}
+
 // Helper: segment intersection between p1-p2 and p3-p4. Returns true if intersect and sets intersection point
 static bool segSegIntersection(const IPoint &p1,const IPoint &p2,const IPoint &p3,const IPoint &p4, IPoint &out){
     double x1=p1.first, y1=p1.second;
@@ -114,44 +460,254 @@ bool bruteForceClipSegment(const IPoint &a, const IPoint &b, const std::vector<I
 }
 
 bool cyrusBeckClip(const IPoint &a, const IPoint &b, const std::vector<IPoint> &convexPoly, IPoint &outA, IPoint &outB){
-    // Parametric line P(t) = a + t*(b-a), t in [0,1]
-    // For each edge i of convex polygon with outward normal n_i and point p_i on edge, compute t_i = (n_i dot (p_i - a)) / (n_i dot (b-a))
-    // Maintain tE (enter) = 0 and tL (leave) = 1; update accordingly. If tE > tL reject.
-    int n = (int)convexPoly.size();
-    if(n < 3) return false;
-    double tE = 0.0, tL = 1.0;
-    double dx = b.first - a.first; double dy = b.second - a.second;
-    for(int i=0;i<n;++i){
-        IPoint p0 = convexPoly[i];
-        IPoint p1 = convexPoly[(i+1)%n];
-        // edge vector
-        double ex = p1.first - p0.first;
-        double ey = p1.second - p0.second;
-        // outward normal for CCW polygon: n = (ey, -ex) (try to compute consistent normal)
-        double nx = ey; double ny = -ex;
-        double wx = a.first - p0.first; double wy = a.second - p0.second;
-        double num = nx * (-wx) + ny * (-wy); // n dot (p_i - a) = - n dot (a - p_i)
-        double den = nx * dx + ny * dy; // n dot (b-a)
-        if(fabs(den) < 1e-9){
-            if(num < 0) return false; // line parallel and outside
-            else continue; // parallel and inside, no constraint
+    // janela montada a cada chamada (reaproveitando a memória); para muitos
+    // segmentos contra a mesma janela, use um ClipWindow
+    static thread_local ClipWindow window;
+    window.set(convexPoly);
+    return window.clip(a, b, outA, outB);
+}
+
+// ------------------------
+// Janela poligonal preparada
+// ------------------------
+
+void PolygonWindow::set(const std::vector<IPoint>& poly){
+    m_edges.clear();
+    m_cellStart.clear(); m_cellEdges.clear();
+    m_slabY.clear(); m_rowSlab.clear(); m_slabStart.clear(); m_slabEdges.clear(); m_slabSorted.clear();
+    size_t n = poly.size();
+    if(n < 3) return;
+    // sem teste de área: um polígono que se cruza pode ter área com sinal nula
+    // e ainda assim interior pela regra par-ímpar
+    // aresta i vai de poly[i] a poly[i-1], como no pointInPoly (mesma conta de x)
+    for(size_t i = 0, j = n - 1; i < n; j = i++){
+        if(poly[i] == poly[j]) continue; // vértice repetido
+        m_edges.push_back(Edge{poly[i].first, poly[i].second, poly[j].first, poly[j].second});
+    }
+    if(m_edges.size() < 3){ m_edges.clear(); return; }
+    m_xmin = m_xmax = poly[0].first;
+    m_ymin = m_ymax = poly[0].second;
+    for(const IPoint &p: poly){
+        m_xmin = std::min(m_xmin, p.first); m_xmax = std::max(m_xmax, p.first);
+        m_ymin = std::min(m_ymin, p.second); m_ymax = std::max(m_ymax, p.second);
+    }
+    size_t ne = m_edges.size();
+
+    // grade com ~1 célula por aresta, na proporção da caixa
+    double w = m_xmax - m_xmin + 1.0, h = m_ymax - m_ymin + 1.0;
+    m_gw = std::max(1, std::min((int)ne, (int)std::ceil(std::sqrt(ne * w / h))));
+    m_gh = std::max(1, std::min((int)ne, (int)std::ceil((double)ne / m_gw)));
+    m_cellW = w / m_gw;
+    m_cellH = h / m_gh;
+    // duas passadas: contagem por célula, depois preenchimento das listas
+    m_cellStart.assign((size_t)m_gw * m_gh + 1, 0);
+    for(const Edge &e: m_edges)
+        forEachCell(e.x0, e.y0, e.x1, e.y1, [&](size_t c){ ++m_cellStart[c + 1]; });
+    for(size_t c = 1; c < m_cellStart.size(); ++c) m_cellStart[c] += m_cellStart[c - 1];
+    m_cellEdges.resize(m_cellStart.back());
+    std::vector<uint32_t> fill(m_cellStart.begin(), m_cellStart.end() - 1);
+    for(size_t k = 0; k < ne; ++k){
+        const Edge &e = m_edges[k];
+        forEachCell(e.x0, e.y0, e.x1, e.y1, [&](size_t c){ m_cellEdges[fill[c]++] = (uint32_t)k; });
+    }
+
+    // faixas entre os y distintos dos vértices; cada aresta não horizontal entra
+    // em todas as faixas que cobre
+    for(const Edge &e: m_edges) m_slabY.push_back(e.y0);
+    std::sort(m_slabY.begin(), m_slabY.end());
+    m_slabY.erase(std::unique(m_slabY.begin(), m_slabY.end()), m_slabY.end());
+    size_t slabs = m_slabY.size() - 1;
+    auto slabRange = [&](const Edge &e, size_t &s0, size_t &s1){
+        s0 = std::lower_bound(m_slabY.begin(), m_slabY.end(), std::min(e.y0, e.y1)) - m_slabY.begin();
+        s1 = std::lower_bound(m_slabY.begin(), m_slabY.end(), std::max(e.y0, e.y1)) - m_slabY.begin();
+    };
+    m_slabStart.assign(slabs + 1, 0);
+    for(const Edge &e: m_edges){
+        size_t s0, s1;
+        slabRange(e, s0, s1);
+        for(size_t s = s0; s < s1; ++s) ++m_slabStart[s + 1];
+    }
+    for(size_t s = 1; s <= slabs; ++s) m_slabStart[s] += m_slabStart[s - 1];
+    m_slabEdges.resize(m_slabStart.back());
+    fill.assign(m_slabStart.begin(), m_slabStart.end() - 1);
+    for(size_t k = 0; k < ne; ++k){
+        size_t s0, s1;
+        slabRange(m_edges[k], s0, s1);
+        for(size_t s = s0; s < s1; ++s) m_slabEdges[fill[s]++] = (uint32_t)k;
+    }
+    // faixa de cada linha inteira da caixa (sem tabela para janelas muito altas)
+    m_rowSlab.clear();
+    if((long long)m_ymax - m_ymin < (1 << 20)){
+        m_rowSlab.resize((size_t)(m_ymax - m_ymin));
+        for(size_t s = 0; s < slabs; ++s)
+            for(int y = m_slabY[s]; y < m_slabY[s + 1]; ++y) m_rowSlab[(size_t)(y - m_ymin)] = (uint32_t)s;
+    }
+    // ordena cada faixa pelo x no meio; sem cruzamentos, a ordem vale na faixa
+    // toda, o que é conferido nas duas bordas
+    m_slabSorted.assign(slabs, 1);
+    for(size_t s = 0; s < slabs; ++s){
+        uint32_t *first = m_slabEdges.data() + m_slabStart[s], *last = m_slabEdges.data() + m_slabStart[s + 1];
+        double lo = m_slabY[s], hi = m_slabY[s + 1], mid = 0.5 * (lo + hi);
+        std::sort(first, last, [&](uint32_t p, uint32_t q){ return crossX(m_edges[p], mid) < crossX(m_edges[q], mid); });
+        for(uint32_t *it = first; it + 1 < last; ++it){
+            const Edge &p = m_edges[it[0]], &q = m_edges[it[1]];
+            if(crossX(p, lo) > crossX(q, lo) || crossX(p, hi) > crossX(q, hi)){ m_slabSorted[s] = 0; break; }
         }
-        double t = num / den;
-        if(den < 0){ // potential entering
-            if(t > tE) tE = t;
-        } else { // potential leaving
-            if(t < tL) tL = t;
+    }
+}
+
+// Chama fn(célula) para cada célula da grade que o segmento pode tocar: por
+// linha da grade, o intervalo de x do segmento dentro dela (com uma folga, para
+// não perder células tocadas só no canto)
+template <typename F>
+void PolygonWindow::forEachCell(double x0, double y0, double x1, double y1, F fn) const {
+    const double EPS = 1e-6;
+    double u0 = (x0 - m_xmin) / m_cellW, v0 = (y0 - m_ymin) / m_cellH;
+    double u1 = (x1 - m_xmin) / m_cellW, v1 = (y1 - m_ymin) / m_cellH;
+    if(v0 > v1){ std::swap(u0, u1); std::swap(v0, v1); }
+    int r0 = std::max(0, (int)std::floor(v0 - EPS)), r1 = std::min(m_gh - 1, (int)std::floor(v1 + EPS));
+    for(int r = r0; r <= r1; ++r){
+        double ua = u0, ub = u1;
+        if(v1 > v0){
+            double va = std::min(std::max((double)r, v0), v1), vb = std::min(std::max(r + 1.0, v0), v1);
+            ua = u0 + (u1 - u0) * (va - v0) / (v1 - v0);
+            ub = u0 + (u1 - u0) * (vb - v0) / (v1 - v0);
         }
-        if(tE > tL) return false;
+        if(ua > ub) std::swap(ua, ub);
+        int c0 = std::max(0, (int)std::floor(ua - EPS)), c1 = std::min(m_gw - 1, (int)std::floor(ub + EPS));
+        for(int c = c0; c <= c1; ++c) fn((size_t)r * m_gw + c);
     }
-    // compute clipped points
-    double ax = a.first, ay = a.second;
-    double bx = b.first, by = b.second;
-    double cx = ax + tE * (bx - ax);
-    double cy = ay + tE * (by - ay);
-    double dxp = ax + tL * (bx - ax);
-    double dyp = ay + tL * (by - ay);
-    outA.first = (int)std::round(cx); outA.second = (int)std::round(cy);
-    outB.first = (int)std::round(dxp); outB.second = (int)std::round(dyp);
-    return true;
+}
+
+bool PolygonWindow::contains(double x, double y) const {
+    if(m_edges.empty() || y < m_slabY.front() || y >= m_slabY.back()) return false;
+    // as bordas das faixas são inteiras: a faixa de y é a da linha floor(y)
+    size_t s = m_rowSlab.empty() ? std::upper_bound(m_slabY.begin(), m_slabY.end(), y) - m_slabY.begin() - 1
+                                 : m_rowSlab[(size_t)((long long)std::floor(y) - m_ymin)];
+    const uint32_t *first = m_slabEdges.data() + m_slabStart[s], *last = m_slabEdges.data() + m_slabStart[s + 1];
+    // toda aresta da faixa cruza a horizontal y; conta as que cruzam à direita de x
+    size_t right = 0;
+    if(m_slabSorted[s]){
+        right = last - std::partition_point(first, last, [&](uint32_t k){ return !(x < crossX(m_edges[k], y)); });
+    } else {
+        for(const uint32_t *it = first; it != last; ++it)
+            if(x < crossX(m_edges[*it], y)) ++right;
+    }
+    return (right & 1) != 0;
+}
+
+size_t PolygonWindow::clip(const IPoint &a, const IPoint &b, SegmentSoA& out) const {
+    if(m_edges.empty()) return 0;
+    if(computeOutCode(a.first, a.second, m_xmin, m_ymin, m_xmax, m_ymax) &
+       computeOutCode(b.first, b.second, m_xmin, m_ymin, m_xmax, m_ymax)) return 0;
+    double ax = a.first, ay = a.second, dx = b.first - ax, dy = b.second - ay;
+    // só a parte dentro da caixa percorre a grade (Liang-Barsky contra a caixa)
+    double t0 = 0.0, t1 = 1.0;
+    const double p[4] = {-dx, dx, -dy, dy};
+    const double q[4] = {ax - m_xmin, m_xmax - ax, ay - m_ymin, m_ymax - ay};
+    for(int i = 0; i < 4; ++i){
+        if(p[i] == 0){
+            if(q[i] < 0) return 0;
+        } else {
+            double t = q[i] / p[i];
+            if(p[i] < 0) t0 = std::max(t0, t);
+            else t1 = std::min(t1, t);
+        }
+    }
+    if(t0 > t1) return 0;
+
+    // parâmetros t das interseções com as arestas das células atravessadas,
+    // cada aresta testada uma vez (marca por consulta)
+    static thread_local std::vector<uint32_t> stamp;
+    static thread_local uint32_t query = 0;
+    static thread_local std::vector<double> ts;
+    if(stamp.size() < m_edges.size()) stamp.resize(m_edges.size(), 0);
+    if(++query == 0){
+        std::fill(stamp.begin(), stamp.end(), 0);
+        query = 1;
+    }
+    ts.clear();
+    ts.push_back(0.0);
+    forEachCell(ax + t0 * dx, ay + t0 * dy, ax + t1 * dx, ay + t1 * dy, [&](size_t c){
+        for(uint32_t i = m_cellStart[c]; i < m_cellStart[c + 1]; ++i){
+            uint32_t k = m_cellEdges[i];
+            if(stamp[k] == query) continue;
+            stamp[k] = query;
+            const Edge &e = m_edges[k];
+            double ex = e.x1 - e.x0, ey = e.y1 - e.y0;
+            double wx = e.x0 - ax, wy = e.y0 - ay;
+            double den = dx * ey - dy * ex;
+            if(den == 0) continue; // paralela (coordenadas inteiras: exato)
+            double tn = wx * ey - wy * ex, un = wx * dy - wy * dx;
+            if(den < 0){ den = -den; tn = -tn; un = -un; }
+            if(tn < 0 || tn > den || un < 0 || un > den) continue;
+            ts.push_back(tn / den);
+        }
+    });
+    ts.push_back(1.0);
+    std::sort(ts.begin(), ts.end());
+
+    // cada intervalo entre cortes está todo dentro ou todo fora: decide pelo
+    // ponto médio, juntando intervalos dentro vizinhos (toque num vértice)
+    size_t count = 0;
+    bool open = false;
+    double start = 0.0;
+    auto emit = [&](double tEnd){
+        out.push((int)std::round(ax + start * dx), (int)std::round(ay + start * dy),
+                 (int)std::round(ax + tEnd * dx), (int)std::round(ay + tEnd * dy));
+        ++count;
+    };
+    for(size_t i = 0; i + 1 < ts.size(); ++i){
+        if(ts[i + 1] == ts[i]) continue;
+        double mid = 0.5 * (ts[i] + ts[i + 1]);
+        bool in = contains(ax + mid * dx, ay + mid * dy);
+        if(in && !open){ open = true; start = ts[i]; }
+        else if(!in && open){ open = false; emit(ts[i]); }
+    }
+    if(open) emit(1.0);
+    return count;
+}
+
+size_t PolygonWindow::clipBatch(const SegmentSoA& segs, SegmentSoA& out, std::vector<uint32_t>& source) const {
+    out.clear();
+    source.clear();
+    if(m_edges.empty()) return 0;
+    auto range = [&](size_t first, size_t last, SegmentSoA& o, std::vector<uint32_t>& src){
+        for(size_t k = first; k < last; ++k){
+            size_t got = clip(IPoint(segs.x0[k], segs.y0[k]), IPoint(segs.x1[k], segs.y1[k]), o);
+            src.insert(src.end(), got, (uint32_t)k);
+        }
+    };
+    // blocos menores que os dos outros lotes: cada segmento custa bem mais
+    const size_t CHUNK = (size_t)1 << 12;
+    size_t n = segs.size();
+    if(n <= CHUNK){
+        range(0, n, out, source);
+        return source.size();
+    }
+    size_t chunks = (n + CHUNK - 1) / CHUNK;
+    static thread_local std::vector<SegmentSoA> partsLocal;
+    static thread_local std::vector<std::vector<uint32_t>> partSrcLocal;
+    // referências: o lambda não captura thread_local (ver clipInChunks)
+    std::vector<SegmentSoA> &parts = partsLocal;
+    std::vector<std::vector<uint32_t>> &partSrc = partSrcLocal;
+    if(parts.size() < chunks){ parts.resize(chunks); partSrc.resize(chunks); }
+    parallelFor(chunks, [&](size_t c){
+        parts[c].clear();
+        partSrc[c].clear();
+        range(c * CHUNK, std::min(n, (c + 1) * CHUNK), parts[c], partSrc[c]);
+    });
+    size_t total = 0;
+    for(size_t c = 0; c < chunks; ++c) total += partSrc[c].size();
+    out.reserve(total);
+    source.reserve(total);
+    for(size_t c = 0; c < chunks; ++c){
+        const SegmentSoA &p = parts[c];
+        out.x0.insert(out.x0.end(), p.x0.begin(), p.x0.end());
+        out.y0.insert(out.y0.end(), p.y0.begin(), p.y0.end());
+        out.x1.insert(out.x1.end(), p.x1.begin(), p.x1.end());
+        out.y1.insert(out.y1.end(), p.y1.begin(), p.y1.end());
+        source.insert(source.end(), partSrc[c].begin(), partSrc[c].end());
+    }
+    return source.size();
 }
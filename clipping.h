@@ -1,4 +1,6 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
 #include <utility>
 #include <vector>
 
@@ -16,10 +18,196 @@ enum OutCode {
 // Cohen-Sutherland clipping against axis-aligned rectangle (xmin,ymin)-(xmax,ymax)
 bool cohenSutherlandClip(int &x0, int &y0, int &x1, int &y1, int xmin, int ymin, int xmax, int ymax);
 
+// Segmentos em estrutura de arrays: cada coordenada num vetor separado, para que
+// os outcodes de 4 (SSE2) ou 8 (AVX2) segmentos sejam calculados de uma vez
+struct SegmentSoA {
+    std::vector<int> x0, y0, x1, y1;
+
+    size_t size() const { return x0.size(); }
+    void clear(){ x0.clear(); y0.clear(); x1.clear(); y1.clear(); }
+    void reserve(size_t n){ x0.reserve(n); y0.reserve(n); x1.reserve(n); y1.reserve(n); }
+    void push(int ax, int ay, int bx, int by){ x0.push_back(ax); y0.push_back(ay); x1.push_back(bx); y1.push_back(by); }
+};
+
+// Cohen-Sutherland em lote. Os outcodes das duas pontas são calculados com SIMD
+// (conjunto de spankernel.h) e decidem em bloco os segmentos totalmente dentro
+// (aceitos sem mudança) e os totalmente fora de um mesmo lado (descartados); só
+// os restantes passam pelo recorte iterativo de cohenSutherlandClip, que os
+// altera em lugar. visible recebe, em ordem, os índices dos segmentos que têm
+// alguma parte no retângulo. Lotes grandes são divididos entre as threads do pool.
+// Resultado idêntico a chamar cohenSutherlandClip em cada segmento.
+size_t cohenSutherlandClipBatch(SegmentSoA& segs, int xmin, int ymin, int xmax, int ymax, std::vector<uint32_t>& visible);
+
+// Bresenham recortado a [xmin,xmax] x [ymin,ymax]. Faz a mesma redução ao
+// primeiro octante de bresenhamLine/drawLineBresenham (steep, troca das pontas,
+// err = dx/2) e devolve o estado do laço no primeiro passo visível, com o termo
+// de erro calculado em forma fechada nesse passo: os pixels produzidos são
+// exatamente os pixels visíveis da linha inteira, em count passos, todos dentro
+// do retângulo (o laço não precisa testar limites).
+struct BresenhamClip {
+    bool steep;   // eixo principal é y (pixels plotados como (y, x))
+    int x, y;     // primeiro pixel visível, nas coordenadas reduzidas
+    int count;    // passos visíveis (0: linha fora do retângulo)
+    int err;      // termo de erro antes do primeiro passo visível
+    int dx, dy;   // incrementos do erro
+    int ystep;    // +1 ou -1
+};
+
+bool clipBresenham(int x0, int y0, int x1, int y1, int xmin, int ymin, int xmax, int ymax, BresenhamClip& out);
+
+// Os mesmos count pixels do laço de Bresenham a partir de c, em trechos
+// (run-slice): cada trecho é a sequência de passos com o mesmo y reduzido,
+// entregue como fn(y, x0, x1) nas coordenadas reduzidas (com c.steep, uma
+// coluna da tela; sem, uma linha). O primeiro trecho custa uma divisão; os
+// seguintes têm q ou q+1 pixels (q = dx/dy), decidido por uma comparação do
+// termo de erro.
+template <typename F>
+void forEachBresenhamRun(const BresenhamClip& c, F fn){
+    int x = c.x, y = c.y, left = c.count;
+    if(left <= 0) return;
+    if(c.dy == 0){
+        fn(y, x, x + left - 1);
+        return;
+    }
+    // no laço, o passo que torna err negativo muda y: com err >= 0 no pixel
+    // atual, o trecho tem err/dy + 1 pixels e o erro seguinte fica em [dx-dy, dx)
+    long long err = c.err;
+    const int q = c.dx / c.dy;
+    const long long qdy = (long long)q * c.dy;
+    int k = (int)(err / c.dy) + 1;
+    for(;;){
+        if(k >= left){
+            fn(y, x, x + left - 1);
+            return;
+        }
+        fn(y, x, x + k - 1);
+        x += k;
+        left -= k;
+        err += c.dx - (long long)k * c.dy;
+        y += c.ystep;
+        k = q + (err >= qdy);
+    }
+}
+
+// Rasteriza c em trechos (run(y, x0, x1), como forEachBresenhamRun) quando eles
+// têm pelo menos 2 pixels (dx >= 2*dy). Nas linhas quase diagonais os trechos
+// têm 1 ou 2 pixels e o laço passo a passo é mais barato: pixel(y, x) é chamado
+// para cada pixel. Coordenadas reduzidas nos dois casos.
+template <typename RunFn, typename PixelFn>
+void rasterizeBresenham(const BresenhamClip& c, RunFn run, PixelFn pixel){
+    if(c.dx >= 2 * (long long)c.dy){
+        forEachBresenhamRun(c, run);
+        return;
+    }
+    int x = c.x, y = c.y, err = c.err;
+    for(int i = 0; i < c.count; ++i){
+        pixel(y, x);
+        ++x;
+        err -= c.dy;
+        if(err < 0){ y += c.ystep; err += c.dx; }
+    }
+}
+
+// Sutherland-Hodgman para o scanline fill (regra par-ímpar, linhas [ymin,ymax)).
+// Uma passada por lado do retângulo [xmin,xmax] x [ymin,ymax], como no algoritmo
+// original, mas em vez de criar vértices de interseção (que, arredondados,
+// mudariam a inclinação das arestas visíveis) cada sequência de vértices fora do
+// mesmo lado é reduzida às suas duas pontas: a aresta que as liga fica inteira
+// daquele lado e cruza cada linha com a mesma paridade do trecho removido. Os
+// pixels dentro do retângulo são exatamente os do polígono original, e o
+// polígono resultante só tem, além dos vértices visíveis, duas pontas por
+// saída do retângulo. out vazio: nada do polígono é visível.
+void clipPolygonForFill(const std::vector<IPoint>& poly, int xmin, int ymin, int xmax, int ymax, std::vector<IPoint>& out);
+// O mesmo, com o buffer intermediário do chamador. Nenhuma passada gera mais
+// vértices do que recebe, então out e scratch não passam de poly.size()
+// elementos: com essa capacidade reservada a chamada não aloca.
+void clipPolygonForFill(const std::vector<IPoint>& poly, int xmin, int ymin, int xmax, int ymax,
+                        std::vector<IPoint>& out, std::vector<IPoint>& scratch);
+
 // Brute-force clipping: clip a segment against a convex polygon by checking intersections
 // polygon is a list of points in order (convex or not) representing the clipping window
+// Devolve só o primeiro trecho visível; para janelas côncavas use PolygonWindow.
 bool bruteForceClipSegment(const IPoint &a, const IPoint &b, const std::vector<IPoint> &poly, IPoint &outA, IPoint &outB);
 
 // Cyrus-Beck parametric clipping for convex polygon window
-// Returns true if clipped segment exists; outA/outB are clipped endpoints
+// Returns true if clipped segment exists; outA/outB are clipped endpoints.
+// Aceita janela em qualquer sentido (monta um ClipWindow a cada chamada).
 bool cyrusBeckClip(const IPoint &a, const IPoint &b, const std::vector<IPoint> &convexPoly, IPoint &outA, IPoint &outB);
+
+// Janela convexa de recorte (Cyrus-Beck) montada uma vez: o sentido dos vértices
+// é normalizado (horário ou anti-horário) e cada aresta vira uma normal para
+// fora n e uma constante c = n.p, com o interior em n.P <= c. Recortar um
+// segmento custa então um par de produtos escalares por aresta; antes disso, os
+// outcodes contra a caixa da janela descartam os segmentos todos de um lado dela. Polígonos com
+// menos de 3 arestas não degeneradas (ou área nula) dão uma janela vazia.
+class ClipWindow {
+public:
+    ClipWindow() = default;
+    explicit ClipWindow(const std::vector<IPoint>& convexPoly){ set(convexPoly); }
+
+    void set(const std::vector<IPoint>& convexPoly);
+    bool empty() const { return m_edges.empty(); }
+
+    // mesmo resultado de cyrusBeckClip
+    bool clip(const IPoint &a, const IPoint &b, IPoint &outA, IPoint &outB) const;
+    // recorta em lugar; visible recebe, em ordem, os índices dos segmentos que
+    // têm parte na janela (lotes grandes divididos entre as threads do pool)
+    size_t clipBatch(SegmentSoA& segs, std::vector<uint32_t>& visible) const;
+
+private:
+    struct Edge { double nx, ny, c; };
+    bool clipParams(double ax, double ay, double dx, double dy, double& tE, double& tL) const;
+
+    std::vector<Edge> m_edges;
+    int m_xmin = 0, m_ymin = 0, m_xmax = -1, m_ymax = -1; // caixa da janela
+};
+// Janela poligonal qualquer (côncava, regra par-ímpar) preparada uma vez para
+// recortar muitos segmentos:
+//  - grade uniforme de arestas sobre a caixa da janela (cerca de uma célula por
+//    aresta), cada célula com as arestas que passam por ela: um segmento só é
+//    testado contra as arestas das células que atravessa;
+//  - faixas horizontais entre os y distintos dos vértices, cada uma com as
+//    arestas que a cruzam ordenadas por x: o teste de ponto dentro é uma busca
+//    binária na faixa e outra na aresta, O(log n) em vez de O(n).
+// clip devolve todos os trechos visíveis do segmento (uma janela côncava pode
+// cortá-lo em vários), em ordem de a para b. Pensada para polígonos simples;
+// numa faixa em que arestas se cruzam o teste de dentro cai para a contagem
+// linear das arestas daquela faixa.
+class PolygonWindow {
+public:
+    PolygonWindow() = default;
+    explicit PolygonWindow(const std::vector<IPoint>& poly){ set(poly); }
+
+    void set(const std::vector<IPoint>& poly);
+    bool empty() const { return m_edges.empty(); }
+
+    // mesma regra (e mesma conta) do pointInPoly de bruteForceClipSegment
+    bool contains(double x, double y) const;
+
+    // acrescenta a out os trechos visíveis de a-b; retorna quantos
+    size_t clip(const IPoint &a, const IPoint &b, SegmentSoA& out) const;
+    // trechos de todos os segmentos, em ordem; source[i] é o índice do
+    // segmento de origem do trecho i (lotes grandes divididos entre as threads)
+    size_t clipBatch(const SegmentSoA& segs, SegmentSoA& out, std::vector<uint32_t>& source) const;
+
+private:
+    struct Edge { int x0, y0, x1, y1; };
+    template <typename F> void forEachCell(double x0, double y0, double x1, double y1, F fn) const;
+    double crossX(const Edge& e, double y) const {
+        return e.x0 + (e.x1 - e.x0) * (y - e.y0) / (double)(e.y1 - e.y0);
+    }
+
+    std::vector<Edge> m_edges;
+    int m_xmin = 0, m_ymin = 0, m_xmax = -1, m_ymax = -1;
+
+    // grade de arestas (células em linhas, listas concatenadas)
+    int m_gw = 0, m_gh = 0;
+    double m_cellW = 1.0, m_cellH = 1.0;
+    std::vector<uint32_t> m_cellStart, m_cellEdges;
+
+    // faixas [m_slabY[s], m_slabY[s+1]) com as arestas em m_slabEdges
+    std::vector<int> m_slabY;
+    std::vector<uint32_t> m_slabStart, m_slabEdges;
+    std::vector<uint8_t> m_slabSorted;
+    std::vector<uint32_t> m_rowSlab; // faixa de cada linha y - m_ymin
+};
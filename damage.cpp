@@ -0,0 +1,36 @@
+#include "damage.h"
+
+// dois retângulos são fundidos se se sobrepõem ou são adjacentes
+static bool touches(const Rect &a, const Rect &b){
+    return a.x0 <= b.x1 + 1 && b.x0 <= a.x1 + 1 && a.y0 <= b.y1 + 1 && b.y0 <= a.y1 + 1;
+}
+
+void DamageTracker::add(const Rect &r){
+    Rect c = rectIntersect(r, m_bounds);
+    if(c.empty()) return;
+    // funde com os existentes até não haver mais contato (a união pode alcançar outros)
+    bool merged = true;
+    while(merged){
+        merged = false;
+        for(size_t i = 0; i < m_rects.size(); ++i){
+            if(touches(m_rects[i], c)){
+                c = rectUnion(m_rects[i], c);
+                m_rects[i] = m_rects.back();
+                m_rects.pop_back();
+                merged = true;
+                break;
+            }
+        }
+    }
+    m_rects.push_back(c);
+    if(m_rects.size() > MAX_RECTS){
+        Rect u = unionRect();
+        m_rects.assign(1, u);
+    }
+}
+
+Rect DamageTracker::unionRect() const {
+    Rect u = emptyRect();
+    for(auto &r: m_rects) u = rectUnion(u, r);
+    return u;
+}
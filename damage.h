@@ -0,0 +1,49 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+
+// Retângulo inteiro com limites inclusivos: [x0,x1] x [y0,y1]
+struct Rect {
+    int x0, y0, x1, y1;
+    bool empty() const { return x1 < x0 || y1 < y0; }
+    long long area() const { return empty() ? 0 : (long long)(x1 - x0 + 1) * (y1 - y0 + 1); }
+};
+
+inline Rect emptyRect(){ return Rect{0, 0, -1, -1}; }
+
+inline Rect rectUnion(const Rect &a, const Rect &b){
+    if(a.empty()) return b;
+    if(b.empty()) return a;
+    return Rect{std::min(a.x0,b.x0), std::min(a.y0,b.y0), std::max(a.x1,b.x1), std::max(a.y1,b.y1)};
+}
+
+inline Rect rectIntersect(const Rect &a, const Rect &b){
+    return Rect{std::max(a.x0,b.x0), std::max(a.y0,b.y0), std::min(a.x1,b.x1), std::min(a.y1,b.y1)};
+}
+
+inline bool rectOverlaps(const Rect &a, const Rect &b){
+    return !rectIntersect(a, b).empty();
+}
+
+// Acumula as regiões da tela que mudaram desde o último quadro.
+// Mantém poucos retângulos: retângulos que se tocam são fundidos e, acima de
+// MAX_RECTS, tudo colapsa no retângulo envolvente.
+class DamageTracker {
+public:
+    static const size_t MAX_RECTS = 8;
+
+    void setBounds(int w, int h){ m_bounds = Rect{0, 0, w - 1, h - 1}; }
+    const Rect& bounds() const { return m_bounds; }
+
+    void add(const Rect &r);
+    void addAll(){ m_rects.assign(1, m_bounds); }
+    void clear(){ m_rects.clear(); }
+
+    bool empty() const { return m_rects.empty(); }
+    const std::vector<Rect>& rects() const { return m_rects; }
+    Rect unionRect() const;
+
+private:
+    Rect m_bounds = emptyRect();
+    std::vector<Rect> m_rects;
+};
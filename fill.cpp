@@ -1,4 +1,5 @@
 #include "fill.h"
+#include "clipping.h"
 #include <cmath>
 #include <GL/gl.h>
 
@@ -7,55 +8,231 @@
 #endif
 
 #include <algorithm>
+#include <climits>
 #include <stack>
 #include <cassert>
+#include "threadpool.h"
 
-// Scanline fill (par-ímpar). polygon: lista de (x,y) inteiros
+// Aresta para o scanline fill: x(y) = x0 + (y - y0) * dx / dy, guardado como
+// parte inteira + resto (dy > 0), avançado de forma incremental e exata a cada linha
+struct ScanEdge {
+    int ymin, ymax;   // linhas cobertas: [ymin, ymax)
+    int x, rem;       // floor(x(y)) e resto em [0, dy)
+    int dy, stepX, stepRem; // dx = stepX * dy + stepRem, 0 <= stepRem < dy
+};
+
+static inline int floorDiv(int a, int b){ // b > 0
+    int q = a / b;
+    if((a % b) != 0 && (a < 0)) --q;
+    return q;
+}
+
+// posiciona a aresta na linha y (ymin <= y): x(y) exato, sem passar linha a linha
+static inline void advanceEdgeTo(ScanEdge &e, int y){
+    long long s = (long long)(y - e.ymin);
+    long long acc = e.rem + s * e.stepRem;
+    e.x += (int)(s * e.stepX + acc / e.dy);
+    e.rem = (int)(acc % e.dy);
+    e.ymin = y;
+}
+
+// Resultado de uma faixa de linhas do scanline fill
+struct ScanBand {
+    int y0, y1;                // linhas [y0,y1]
+    std::vector<ScanEdge> aet;
+    std::vector<Span> glSpans; // spans para o GL (sem framebuffer)
+    Rect filled = emptyRect();
+};
+
+// Preenche as linhas [b.y0,b.y1]. A AET da faixa é montada direto em y0 a partir
+// da ET (arestas com ymin <= y0 < ymax, já avançadas até y0), então faixas
+// diferentes não dependem umas das outras. Com framebuffer, cada faixa escreve
+// só nas suas linhas.
+static void fillScanBand(const std::vector<ScanEdge>& et, ScanBand& b, const Color& c, bool toBuffer){
+    std::vector<ScanEdge> &aet = b.aet;
+    aet.clear();
+    // ET ordenada por ymin: as arestas com ymin <= y0 formam um prefixo
+    size_t next = std::upper_bound(et.begin(), et.end(), b.y0,
+                                   [](int y, const ScanEdge &e){ return y < e.ymin; }) - et.begin();
+    for(size_t i=0;i<next;++i){
+        if(et[i].ymax <= b.y0) continue;
+        aet.push_back(et[i]);
+        advanceEdgeTo(aet.back(), b.y0);
+    }
+    std::sort(aet.begin(), aet.end(), [](const ScanEdge &a, const ScanEdge &e){ return a.x < e.x; });
+
+    for(int y = b.y0; y <= b.y1 && (next < et.size() || !aet.empty()); ++y){
+        // entra: arestas que começam nesta linha
+        while(next < et.size() && et[next].ymin == y) aet.push_back(et[next++]);
+        // sai: arestas que terminaram (y >= ymax)
+        size_t k = 0;
+        for(size_t i=0;i<aet.size();++i) if(y < aet[i].ymax) aet[k++] = aet[i];
+        aet.resize(k);
+        // AET quase ordenada de uma linha para a outra: ordenação por inserção
+        for(size_t i=1;i<aet.size();++i){
+            ScanEdge e = aet[i];
+            size_t j = i;
+            while(j > 0 && aet[j-1].x > e.x){ aet[j] = aet[j-1]; --j; }
+            aet[j] = e;
+        }
+        for(size_t i=0;i+1<aet.size();i+=2){
+            int xstart = aet[i].x;
+            int xend = aet[i+1].x;
+            if(xstart > xend) continue;
+            if(toBuffer) drawHLine(y, xstart, xend, c);
+            else b.glSpans.push_back(Span{y, xstart, xend});
+            b.filled = rectUnion(b.filled, Rect{xstart, y, xend, y});
+        }
+        // passo incremental de x para a próxima linha
+        for(auto &e: aet){
+            e.x += e.stepX;
+            e.rem += e.stepRem;
+            if(e.rem >= e.dy){ e.rem -= e.dy; ++e.x; }
+        }
+        // pula linhas sem arestas ativas até a próxima aresta
+        if(aet.empty() && next < et.size()) y = et[next].ymin - 1;
+    }
+}
+
+// Scanline fill (par-ímpar) com tabela global de arestas (ET) ordenada por ymin e
+// tabela de arestas ativas (AET) mantida ordenada por x. polygon: lista de (x,y) inteiros.
+// Os spans vão direto para o framebuffer por drawHLine e a região preenchida é
+// enviada à tela de uma vez; sem framebuffer, os spans seguem numa única submissão GL.
+// Polígonos altos são divididos em faixas de linhas preenchidas em paralelo.
 void fillPolygonScanline(const std::vector<std::pair<int,int>>& polygon, const Color& c){
     if(polygon.size() < 3) return;
-    int miny = polygon[0].second, maxy = polygon[0].second;
-    for(auto &p: polygon){ miny = std::min(miny, p.second); maxy = std::max(maxy, p.second); }
-    for(int y = miny; y <= maxy; ++y){
-        std::vector<int> intersections;
-        for(size_t i=0;i<polygon.size();++i){
-            auto p1 = polygon[i];
-            auto p2 = polygon[(i+1)%polygon.size()];
-            if(p1.second == p2.second) continue; // horizontal edge ignore (or handle per regra)
-            int ymin = std::min(p1.second,p2.second);
-            int ymax = std::max(p1.second,p2.second);
-            if(y < ymin || y >= ymax) continue; // regra de preenchimento consistente
-            // calcula interseção x
-            float x = p1.first + (float)(y - p1.second) * (p2.first - p1.first) / (float)(p2.second - p1.second);
-            intersections.push_back((int)std::floor(x));
-        }
-        std::sort(intersections.begin(), intersections.end());
-        for(size_t k=0;k+1<intersections.size();k+=2){
-            int xstart = intersections[k];
-            int xend = intersections[k+1];
-            for(int x=xstart; x<=xend; ++x){
-                putPixel(x,y,c,true);
+
+    // o polígono é recortado à imagem antes da ET (clipPolygonForFill: mesmos
+    // pixels, sem as arestas fora dela). A imagem é o framebuffer ou, sem ele,
+    // o viewport atual (como em floodFill4ReadPixels)
+    Framebuffer* fb = getFrameBuffer();
+    bool toBuffer = fb != nullptr;
+    int w, h;
+    if(toBuffer){
+        w = fb->width();
+        h = fb->height();
+    } else {
+        GLint vp[4];
+        glGetIntegerv(GL_VIEWPORT, vp);
+        w = vp[2];
+        h = vp[3];
+    }
+    if(w <= 0 || h <= 0) return;
+    static thread_local std::vector<std::pair<int,int>> clipped;
+    clipPolygonForFill(polygon, 0, 0, w - 1, h - 1, clipped);
+    const std::vector<std::pair<int,int>>* poly = &clipped;
+
+    std::vector<ScanEdge> et;
+    et.reserve(poly->size());
+    int ylast = INT_MIN;
+    for(size_t i=0;i<poly->size();++i){
+        auto p1 = (*poly)[i];
+        auto p2 = (*poly)[(i+1)%poly->size()];
+        if(p1.second == p2.second) continue; // horizontal edge ignore (or handle per regra)
+        if(p1.second > p2.second) std::swap(p1, p2);
+        ScanEdge e;
+        e.ymin = p1.second; e.ymax = p2.second; // regra de preenchimento consistente: y < ymax
+        e.dy = p2.second - p1.second;
+        int dx = p2.first - p1.first;
+        e.stepX = floorDiv(dx, e.dy);
+        e.stepRem = dx - e.stepX * e.dy;
+        e.x = p1.first; e.rem = 0;
+        et.push_back(e);
+        ylast = std::max(ylast, e.ymax - 1);
+    }
+    if(et.empty()) return;
+    std::sort(et.begin(), et.end(), [](const ScanEdge &a, const ScanEdge &b){ return a.ymin < b.ymin; });
+
+    // linhas fora da imagem não geram spans
+    int yfirst = std::max(et.front().ymin, 0);
+    ylast = std::min(ylast, h - 1);
+    if(yfirst > ylast) return;
+
+    // faixas de pelo menos SCAN_BAND_MIN_ROWS linhas, no máximo uma por thread
+    const int SCAN_BAND_MIN_ROWS = 64;
+    int rows = ylast - yfirst + 1;
+    int nb = (int)std::min<unsigned>(threadPoolSize(), (unsigned)std::max(1, rows / SCAN_BAND_MIN_ROWS));
+    std::vector<ScanBand> bands(nb);
+    for(int k = 0; k < nb; ++k){
+        bands[k].y0 = yfirst + (int)((long long)rows * k / nb);
+        bands[k].y1 = yfirst + (int)((long long)rows * (k + 1) / nb) - 1;
+    }
+    // sem framebuffer os spans vão para o GL, que fica na thread atual
+    parallelFor(bands.size(), [&](size_t k){ fillScanBand(et, bands[k], c, toBuffer); });
+
+    Rect filled = emptyRect();
+    for(auto &b: bands) filled = rectUnion(filled, b.filled);
+    if(toBuffer){
+        if(!filled.empty()) uploadFrameBufferRegion(filled.x0, filled.y0, filled.x1, filled.y1);
+    } else {
+        for(auto &b: bands) submitSpansGL(b.glSpans, c);
+    }
+}
+
+// flood-fill 4-neighborhood iterative, por spans sobre fb. Os pixels são
+// comparados como palavras de 32 bits (uma instrução por pixel) e lidos por
+// at(), então o mesmo código serve aos layouts linear e em blocos.
+Rect floodFillBuffer(Framebuffer& fb, int x, int y, const Color& newColor){
+    if(!fb.inside(x, y)) return emptyRect();
+    const int w = fb.width(), h = fb.height();
+    const uint32_t orig = fb.at(x, y).packed();
+    if(orig == newColor.packed()) return emptyRect();
+
+    // base da linha calculada uma vez por corrida; só a coluna varia no laço
+    const Color* px0 = fb.data();
+    auto same = [&](size_t rowBase, int px){ return px0[rowBase + fb.colOffset(px)].packed() == orig; };
+    Rect filled = Rect{x, y, x, y};
+    static std::vector<std::pair<int,int>> st; // reaproveitada entre chamadas
+    st.clear();
+    st.push_back({x,y});
+    while(!st.empty()){
+        auto p = st.back(); st.pop_back();
+        int px = p.first, py = p.second;
+        size_t row = fb.rowBase(py);
+        if(!same(row, px)) continue; // já preenchido por outra corrida
+        // expande a corrida até as barreiras e pinta de uma vez
+        int xl = px, xr = px;
+        while(xl > 0 && same(row, xl-1)) --xl;
+        while(xr < w-1 && same(row, xr+1)) ++xr;
+        fb.fillSpan(py, xl, xr, newColor);
+        filled = rectUnion(filled, Rect{xl, py, xr, py});
+        // uma semente por corrida contígua nas linhas vizinhas
+        for(int ny = py - 1; ny <= py + 1; ny += 2){
+            if(ny < 0 || ny >= h) continue;
+            size_t nrow = fb.rowBase(ny);
+            int sx = xl;
+            while(sx <= xr){
+                while(sx <= xr && !same(nrow, sx)) ++sx;
+                if(sx > xr) break;
+                st.push_back({sx, ny});
+                while(sx <= xr && same(nrow, sx)) ++sx;
             }
         }
     }
+    return filled;
 }
 
-// flood-fill 4-neighborhood iterative
-extern Color *g_frame; // não é exportado aqui, mas assumimos setFrameBufferPointer foi chamado
-int g_w = 0;
-int g_h = 0;
-
 void floodFill4(int x, int y, const Color& newColor){
-    // Lê cor original via pixel buffer - assumem setFrameBufferPointer foi chamado no rasterizer
-    // Para não depender de membros estáticos privados, faremos uma leitura via putPixelToBuffer? 
-    // Aqui usamos glReadPixels lentamente como fallback caso framebuffer não exista.
-    // Implementação assume o mesmo framebuffer interno do rasterizer foi configurado.
+    Framebuffer* fb = getFrameBuffer();
+    if(!fb){
+        floodFill4ReadPixels(x, y, newColor);
+        return;
+    }
+    Rect r = floodFillBuffer(*fb, x, y, newColor);
+    if(!r.empty()) uploadFrameBufferRegion(r.x0, r.y0, r.x1, r.y1);
+}
+
+void floodFill4ReadPixels(int x, int y, const Color& newColor){
+    // Sem framebuffer em RAM: lê a cor de cada pixel diretamente da tela.
+    // Limites vêm do viewport atual.
+    GLint vp[4];
+    glGetIntegerv(GL_VIEWPORT, vp);
+    int w = vp[2], h = vp[3];
+    if(x < 0 || y < 0 || x >= w || y >= h) return;
 
-    // Pseudo-acesso: acessaremos via função auxiliar (não exportada); porém para manter simples,
-    // vamos usar glReadPixels para ler cor inicial (menos eficiente, mais simples).
+    // GL_RGBA / GL_UNSIGNED_BYTE tem o mesmo layout de Color
     Color orig;
-    unsigned char pixel[4];
-    glReadPixels(x, y, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
-    orig = Color(pixel[0], pixel[1], pixel[2], pixel[3]);
+    glReadPixels(x, y, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, &orig);
     if(orig == newColor) return;
 
     std::stack<std::pair<int,int>> st;
@@ -64,14 +241,13 @@ void floodFill4(int x, int y, const Color& newColor){
         auto p = st.top(); st.pop();
         int px = p.first, py = p.second;
         // ler cor atual
-        unsigned char buf[4];
-        glReadPixels(px, py, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, buf);
-        Color cur(buf[0], buf[1], buf[2], buf[3]);
-        if(!(cur == orig)) continue;
+        Color cur;
+        glReadPixels(px, py, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, &cur);
+        if(cur != orig) continue;
         putPixel(px, py, newColor, true);
-        if(px+1 < g_w) st.push({px+1, py});
+        if(px+1 < w) st.push({px+1, py});
         if(px-1 >= 0) st.push({px-1, py});
-        if(py+1 < g_h) st.push({px, py+1});
+        if(py+1 < h) st.push({px, py+1});
         if(py-1 >= 0) st.push({px, py-1});
     }
 }
\ No newline at end of file
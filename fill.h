@@ -2,8 +2,17 @@
 #include "rasterizer.h"
 #include <vector>
 
-// preencher polígono via scanline (polígono simples, coordenadas inteiras)
+// preencher polígono via scanline (polígono simples, coordenadas inteiras); polígonos
+// altos são divididos em faixas de linhas preenchidas em paralelo (threadpool.h)
 void fillPolygonScanline(const std::vector<std::pair<int,int>>& polygon, const Color& c);
 
-// flood fill 4-vizinhança iterativo (usa framebuffer interno setado via setFrameBufferPointer)
-void floodFill4(int x, int y, const Color& newColor);
\ No newline at end of file
+// flood fill 4-vizinhança iterativo (usa framebuffer interno setado via setFrameBufferPointer).
+// Lê e escreve só no framebuffer em RAM; a região modificada vai para a tela em um
+// único envio. Sem framebuffer registrado, recorre a floodFill4ReadPixels.
+void floodFill4(int x, int y, const Color& newColor);
+
+// núcleo do flood fill: preenche em fb, sem tocar no GL; devolve a região alterada
+Rect floodFillBuffer(Framebuffer& fb, int x, int y, const Color& newColor);
+
+// fallback lento: lê cada pixel da tela com glReadPixels (uma ida ao driver por pixel)
+void floodFill4ReadPixels(int x, int y, const Color& newColor);
\ No newline at end of file
@@ -0,0 +1,118 @@
+#include "framebuffer.h"
+#include "spankernel.h"
+#include <algorithm>
+
+// fill contínuo de n pixels a partir de dst
+static void fillPixels(Color* dst, size_t n, Color c){
+    uint32_t v = c.packed();
+    if((v & 0xff) * 0x01010101u == v)
+        std::memset(static_cast<void*>(dst), (int)(v & 0xff), n * sizeof(Color)); // branco, transparente...
+    else
+        spanFill32(reinterpret_cast<uint32_t*>(dst), n, v);
+}
+
+void Framebuffer::allocate(Color c){
+    size_t n = size();
+    m_tilesX = 0;
+    m_tileRowStride = 0;
+    if(m_layout == FB_LAYOUT_TILED){
+        // bordas completadas até um bloco inteiro
+        m_tilesX = (m_w + FB_TILE_MASK) >> FB_TILE_SHIFT;
+        m_tileRowStride = (size_t)m_tilesX << (2 * FB_TILE_SHIFT);
+        int tilesY = (m_h + FB_TILE_MASK) >> FB_TILE_SHIFT;
+        n = (size_t)m_tilesX * tilesY << (2 * FB_TILE_SHIFT);
+    }
+    m_storage.assign(n, c);
+    m_px = m_storage.data();
+    m_external = false;
+}
+
+void Framebuffer::resize(int w, int h, Color c){
+    m_w = std::max(w, 0); m_h = std::max(h, 0);
+    allocate(c);
+}
+
+void Framebuffer::attach(Color* px, int w, int h){
+    m_storage.clear();
+    m_storage.shrink_to_fit();
+    m_px = px; m_w = w; m_h = h;
+    m_tilesX = 0;
+    m_tileRowStride = 0;
+    m_layout = FB_LAYOUT_LINEAR;
+    m_external = true;
+}
+
+void Framebuffer::setLayout(FramebufferLayout layout){
+    if(layout == m_layout || m_external) return;
+    std::vector<Color> lin(size());
+    copyToLinear(bounds(), lin.data(), m_w);
+    m_layout = layout;
+    allocate(Color());
+    forEachSegment(bounds(), [&](int y, int x0, int x1, Color* p){
+        const Color* src = lin.data() + (size_t)y * m_w + x0;
+        std::copy(src, src + (x1 - x0 + 1), p);
+    });
+}
+
+void Framebuffer::clear(Color c){
+    if(empty()) return;
+    // no layout em blocos inclui as bordas de preenchimento (nunca lidas)
+    fillPixels(m_px, m_storage.empty() ? size() : m_storage.size(), c);
+}
+
+// abaixo disso fillSpan escreve pixel a pixel
+static const int SHORT_SPAN = 8;
+
+void Framebuffer::fillSpan(int y, int x0, int x1, Color c){
+    if(empty() || y < 0 || y >= m_h) return;
+    x0 = std::max(x0, 0);
+    x1 = std::min(x1, m_w - 1);
+    if(x0 > x1) return;
+    if(x1 - x0 < SHORT_SPAN){
+        // spans curtos (trechos de linhas quase diagonais): direto, sem a
+        // chamada indireta do kernel
+        Color* row = m_px + rowBase(y);
+        for(int x = x0; x <= x1; ++x) row[colOffset(x)] = c;
+        return;
+    }
+    if(m_layout == FB_LAYOUT_LINEAR){
+        spanFill32(reinterpret_cast<uint32_t*>(m_px + (size_t)y * m_w + x0), (size_t)(x1 - x0 + 1), c.packed());
+        return;
+    }
+    forEachSegment(Rect{x0, y, x1, y}, [&](int, int sx0, int sx1, Color* p){
+        spanFill32(reinterpret_cast<uint32_t*>(p), (size_t)(sx1 - sx0 + 1), c.packed());
+    });
+}
+
+void Framebuffer::fillColumn(int x, int y0, int y1, Color c){
+    if(empty() || x < 0 || x >= m_w) return;
+    y0 = std::max(y0, 0);
+    y1 = std::min(y1, m_h - 1);
+    if(m_layout == FB_LAYOUT_LINEAR){
+        Color* p = m_px + (size_t)y0 * m_w + x;
+        for(int y = y0; y <= y1; ++y, p += m_w) *p = c;
+        return;
+    }
+    size_t col = colOffset(x);
+    for(int y = y0; y <= y1; ++y) m_px[rowBase(y) + col] = c;
+}
+
+void Framebuffer::fillRect(const Rect& r, Color c){
+    if(empty()) return;
+    Rect q = rectIntersect(r, bounds());
+    if(q.empty()) return;
+    if(m_layout == FB_LAYOUT_LINEAR && q.x0 == 0 && q.x1 == m_w - 1){
+        // linhas inteiras são contíguas: um único preenchimento
+        fillPixels(m_px + (size_t)q.y0 * m_w, (size_t)(q.y1 - q.y0 + 1) * m_w, c);
+        return;
+    }
+    forEachSegment(q, [&](int, int x0, int x1, Color* p){
+        fillPixels(p, (size_t)(x1 - x0 + 1), c);
+    });
+}
+
+void Framebuffer::copyToLinear(const Rect& r, Color* dst, int dstStride, int originX, int originY) const {
+    forEachSegment(r, [&](int y, int x0, int x1, const Color* p){
+        std::copy(p, p + (x1 - x0 + 1), dst + (size_t)(y - originY) * dstStride + (x0 - originX));
+    });
+}
@@ -0,0 +1,137 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "damage.h"
+
+// Pixel canônico do programa: 4 bytes na ordem R,G,B,A. A memória de um
+// Framebuffer pode ser enviada direto ao GL (GL_RGBA / GL_UNSIGNED_BYTE) e cada
+// pixel cabe numa palavra de 32 bits, o que permite comparar cores com uma
+// instrução e preencher spans com os kernels de spankernel.h.
+struct Color {
+    uint8_t r,g,b,a;
+    Color(uint8_t r_=0,uint8_t g_=0,uint8_t b_=0,uint8_t a_=255):r(r_),g(g_),b(b_),a(a_){}
+
+    uint32_t packed() const { uint32_t v; std::memcpy(&v, this, sizeof(v)); return v; }
+
+    bool operator==(const Color& o) const { return packed() == o.packed(); }
+    bool operator!=(const Color& o) const { return packed() != o.packed(); }
+};
+static_assert(sizeof(Color) == 4, "Color precisa ocupar exatamente 32 bits");
+
+// Organização da memória de um Framebuffer
+enum FramebufferLayout {
+    FB_LAYOUT_LINEAR = 0, // row-major: y * w + x (formato do GL)
+    FB_LAYOUT_TILED,      // blocos FB_TILE x FB_TILE, cada um row-major
+    FB_LAYOUT_COUNT
+};
+const int FB_TILE_SHIFT = 6;
+const int FB_TILE = 1 << FB_TILE_SHIFT; // 64: um bloco = 16 KB, cabe no L1
+const int FB_TILE_MASK = FB_TILE - 1;
+
+// Imagem w x h de Color, linha 0 = base da janela. A memória é própria
+// (resize, em qualquer layout) ou de terceiros (attach, sempre linear).
+// No layout em blocos, percursos verticais (flood fill, linhas íngremes) ficam
+// dentro de um bloco por 64 linhas em vez de tocar uma linha de cache nova a
+// cada pixel; a conversão para linear só acontece no envio ao GL
+// (copyToLinear). Como o endereço depende do layout, o acesso é por at(),
+// offset() ou forEachSegment().
+class Framebuffer {
+public:
+    Framebuffer(){}
+    Framebuffer(const Framebuffer&) = delete;
+    Framebuffer& operator=(const Framebuffer&) = delete;
+
+    // realoca a memória própria com w x h pixels da cor c
+    void resize(int w, int h, Color c);
+    // passa a usar a memória externa px (w x h pixels linear, não copiada nem liberada)
+    void attach(Color* px, int w, int h);
+    // troca o layout preservando a imagem (memória externa fica linear)
+    void setLayout(FramebufferLayout layout);
+    FramebufferLayout layout() const { return m_layout; }
+    bool linear() const { return m_layout == FB_LAYOUT_LINEAR; }
+
+    int width() const { return m_w; }
+    int height() const { return m_h; }
+    size_t size() const { return (size_t)m_w * m_h; }
+    bool empty() const { return m_px == nullptr || m_w <= 0 || m_h <= 0; }
+    Rect bounds() const { return Rect{0, 0, m_w - 1, m_h - 1}; }
+    bool inside(int x, int y) const { return x >= 0 && y >= 0 && x < m_w && y < m_h; }
+
+    // posição de (x,y) na memória; dois Framebuffers com o mesmo tamanho e
+    // layout usam o mesmo offset para o mesmo pixel
+    size_t offset(int x, int y) const { return rowBase(y) + colOffset(x); }
+    // offset(x,y) = rowBase(y) + colOffset(x): percursos numa linha calculam a
+    // base uma vez e somam só a parte da coluna
+    size_t rowBase(int y) const {
+        if(m_layout == FB_LAYOUT_LINEAR) return (size_t)y * m_w;
+        return (size_t)(y >> FB_TILE_SHIFT) * m_tileRowStride + ((size_t)(y & FB_TILE_MASK) << FB_TILE_SHIFT);
+    }
+    size_t colOffset(int x) const {
+        if(m_layout == FB_LAYOUT_LINEAR) return (size_t)x;
+        // (x / FB_TILE) blocos inteiros adiante + coluna dentro do bloco
+        return ((size_t)(x & ~FB_TILE_MASK) << FB_TILE_SHIFT) + (size_t)(x & FB_TILE_MASK);
+    }
+    // memória bruta (na ordem do layout)
+    Color* data(){ return m_px; }
+    const Color* data() const { return m_px; }
+    // acesso sem teste de limites
+    Color& at(int x, int y){ return m_px[offset(x, y)]; }
+    const Color& at(int x, int y) const { return m_px[offset(x, y)]; }
+
+    // chama fn(y, x0, x1, p) para cada trecho horizontal de r (recortado) que é
+    // contíguo na memória, com p apontando para (x0,y): linhas inteiras no
+    // layout linear, a parte de cada linha dentro de um bloco no layout em
+    // blocos (percorridos bloco a bloco). A ordem dos trechos não é garantida.
+    template <typename F>
+    void forEachSegment(const Rect& r, F fn){
+        visitSegments(r, [&](int y, int x0, int x1, size_t off){ fn(y, x0, x1, m_px + off); });
+    }
+    template <typename F>
+    void forEachSegment(const Rect& r, F fn) const {
+        visitSegments(r, [&](int y, int x0, int x1, size_t off){ fn(y, x0, x1, (const Color*)(m_px + off)); });
+    }
+
+    // imagem inteira com a cor c (memset quando os 4 bytes são iguais)
+    void clear(Color c);
+    // span [x0,x1] da linha y, recortado à imagem
+    void fillSpan(int y, int x0, int x1, Color c);
+    // coluna [y0,y1] de x, recortada à imagem
+    void fillColumn(int x, int y0, int y1, Color c);
+    // retângulo r (inclusivo), recortado à imagem
+    void fillRect(const Rect& r, Color c);
+    // copia r (recortado) para uma imagem linear dst com dstStride pixels por
+    // linha, cujo pixel (0,0) corresponde a (originX, originY) desta imagem
+    void copyToLinear(const Rect& r, Color* dst, int dstStride, int originX = 0, int originY = 0) const;
+
+private:
+    template <typename F>
+    void visitSegments(const Rect& r, F fn) const {
+        Rect q = rectIntersect(r, bounds());
+        if(empty() || q.empty()) return;
+        if(m_layout == FB_LAYOUT_LINEAR){
+            for(int y = q.y0; y <= q.y1; ++y) fn(y, q.x0, q.x1, (size_t)y * m_w + q.x0);
+            return;
+        }
+        for(int ty = q.y0 >> FB_TILE_SHIFT; ty <= q.y1 >> FB_TILE_SHIFT; ++ty){
+            int y0 = ty << FB_TILE_SHIFT, y1 = y0 + FB_TILE_MASK;
+            if(y0 < q.y0) y0 = q.y0;
+            if(y1 > q.y1) y1 = q.y1;
+            for(int tx = q.x0 >> FB_TILE_SHIFT; tx <= q.x1 >> FB_TILE_SHIFT; ++tx){
+                int x0 = tx << FB_TILE_SHIFT, x1 = x0 + FB_TILE_MASK;
+                if(x0 < q.x0) x0 = q.x0;
+                if(x1 > q.x1) x1 = q.x1;
+                for(int y = y0; y <= y1; ++y) fn(y, x0, x1, offset(x0, y));
+            }
+        }
+    }
+    void allocate(Color c);
+
+    std::vector<Color> m_storage;
+    Color* m_px = nullptr;
+    int m_w = 0, m_h = 0;
+    int m_tilesX = 0;
+    size_t m_tileRowStride = 0; // pixels de uma fileira de blocos
+    FramebufferLayout m_layout = FB_LAYOUT_LINEAR;
+    bool m_external = false;
+};
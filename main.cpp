@@ -30,7 +30,19 @@
 #include <string>
 #include <sstream>
 #include <iostream>
+#include <chrono>
+#include <climits>
 #include "glut_text.h"
+#include "present.h"
+#include "damage.h"
+#include "span.h"
+#include "framebuffer.h"
+#include "spankernel.h"
+#include "bench.h"
+#include "threadpool.h"
+#include "batchtransform.h"
+#include "spatialgrid.h"
+#include "clipping.h"
 
 #ifndef M_PI
     #define M_PI 3.14159265358979323846
@@ -50,11 +62,7 @@ enum TipoForma
     M_CIRCULO
 };
 
-// Cor (RGB)
-struct Color
-{
-    unsigned char r, g, b;
-};
+// Cor: Color (RGBA, 32 bits) vem de framebuffer.h
 const Color WHITE = {255, 255, 255};
 const Color BLACK = {0, 0, 0};
 const Color RED = {255, 0, 0};
@@ -65,6 +73,7 @@ const Color CYAN = {0, 255, 255};
 const Color MAGENTA = {255, 0, 255};
 const Color ORANGE = {255, 140, 0};
 const Color FILL_COLOR_DEFAULT = {200, 200, 20}; // cor padrão de preenchimento
+const Color OVERLAY_EMPTY = {0, 0, 0, 0};        // alfa 0: pixel sem overlay
 
 // Lista de cores para o menu superior
 std::vector<Color> fillColors = {YELLOW, RED, GREEN, BLUE, CYAN, MAGENTA, ORANGE, BLACK};
@@ -79,14 +88,53 @@ struct V2
     int x, y;
 };
 
-// Forma geométrica (lista de vértices)
+// Cache da rasterização de uma forma: spans (já recortados à janela) produzidos
+// pelo Bresenham/círculo. É reaproveitado a cada redesenho e refeito só quando a
+// forma muda ou a janela é redimensionada.
+struct SpanCache
+{
+    SpanList spans;
+    Rect bounds = emptyRect();
+    bool valid = false;
+};
+
+// Forma geométrica (lista de vértices). As transformações não reescrevem verts:
+// apenas compõem xform, e os vértices na tela (pts()) são calculados a partir
+// dos originais quando a forma é rasterizada ou testada. Assim uma sequência de
+// transformações custa uma multiplicação de matrizes cada e não acumula erro de
+// arredondamento.
 struct Forma
 {
     TipoForma tipo;
     vector<V2> verts; // Para linhas: 2 verts; tri: 3; ret: 2 (sup-esq, inf-dir); pol: n>=4; circ: 2 (centro, ponto raio)
+    Mat3 xform = {{{1, 0, 0}, {0, 1, 0}, {0, 0, 1}}}; // transformação acumulada (originais -> tela)
     Color cor = BLACK;
+    mutable SpanCache cache; // alterar verts, xform ou cor exige invalidateCache()
+    mutable vector<V2> world; // verts transformados por xform (válidos se worldValid)
+    mutable bool worldValid = false;
+
+    void invalidateCache()
+    {
+        cache.valid = false;
+        worldValid = false;
+    }
+    bool transformed() const;
+    bool rectAsPolygon() const;
+    const vector<V2> &pts() const; // vértices na tela (retângulo girado: 4 cantos)
 };
 
+// Contadores do cache de spans: acertos e re-rasterizações (no último quadro e no total)
+struct SpanCacheStats
+{
+    unsigned long frameHits = 0, frameRasterizations = 0;
+    unsigned long totalHits = 0, totalRasterizations = 0;
+};
+SpanCacheStats cacheStats;
+
+// Tempo do último preenchimento (flood fill, scanline ou disco), mostrado na
+// barra de status (vazio até o primeiro)
+char fillInfo[96] = "";
+
 // Dimensões janela / mouse
 int winW = 800, winH = 600;
 int mouse_x = 0, mouse_y = 0;
@@ -106,94 +154,210 @@ bool drawing = false; // se estamos no meio de desenhar
 TipoForma modo = M_LINHA;
 // Modo flood fill (deve ser declarado antes do uso em qualquer função)
 bool floodMode = false;
+// Modo seleção: o clique escolhe a forma sob o cursor (ver pickForma)
+bool selectMode = false;
+int selectedForma = -1; // índice em formas, -1 sem seleção
+
+// Índice espacial das caixas envolventes das formas (índice = posição em formas),
+// mantido ao acrescentar, limpar e transformar formas
+SpatialGrid formaIndex;
+const int PICK_TOLERANCE = 3; // distância máxima (pixels) do clique ao contorno
 
 // Framebuffer auxiliar (armazenar cor de cada pixel)
-vector<Color> framebuffer; // tamanho winW * winH, row-major
+Framebuffer framebuffer; // winW x winH, row-major
 // Overlay buffer to store persistent pixel edits (flood-fill, scanline fills, etc.)
-vector<Color> overlayBuffer;
-vector<unsigned char> overlayMask; // 0 = empty, 1 = has overlay color
+// Pixels com alfa 0 (OVERLAY_EMPTY) não têm overlay
+Framebuffer overlayBuffer;
+
+// Regiões da tela alteradas desde o último quadro (ver damage.h). redrawAll()
+// limpa, recompõe e reenvia apenas essas regiões.
+DamageTracker damage;
+// Destino do registro de dano: Bresenham, círculo e preenchimentos registram aqui
+// o retângulo que tocaram. nullptr durante a recomposição (região já marcada).
+// Por thread: a rasterização paralela das formas não registra dano.
+thread_local DamageTracker *damageRecorder = &damage;
+
+inline void recordDamage(const Rect &r)
+{
+    if (damageRecorder)
+        damageRecorder->add(r);
+}
 
 // forward declaration: idx used by overlay helpers before full utility section
-inline int idx(int x, int y);
+inline size_t idx(int x, int y);
 
 inline void setOverlayPixel(int x, int y, Color c)
 {
     if (x < 0 || x >= winW || y < 0 || y >= winH)
         return;
-    int i = idx(x, y);
-    overlayBuffer[i] = c;
-    overlayMask[i] = 1;
+    overlayBuffer.at(x, y) = c;
+}
+
+// Preenche o span [x0,x1] da linha y no overlay. Recorta uma vez e escreve com o
+// kernel SIMD de 32 bits escolhido em tempo de execução (spankernel.h).
+inline void fillSpan(int y, int x0, int x1, Color c)
+{
+    overlayBuffer.fillSpan(y, x0, x1, c);
 }
 
 inline Color getCombinedPixel(int x, int y)
 {
     if (x < 0 || x >= winW || y < 0 || y >= winH)
         return WHITE;
-    int i = idx(x, y);
-    if (overlayMask[i])
-        return overlayBuffer[i];
-    return framebuffer[i];
+    const Color &o = overlayBuffer.at(x, y);
+    if (o.a)
+        return o;
+    return framebuffer.at(x, y);
 }
 
 // Apply overlay pixels into framebuffer (used when composing before flush)
-void applyOverlayToFramebuffer()
+// Limitado à região r
+void applyOverlayToFramebuffer(const Rect &r)
 {
-    size_t N = framebuffer.size();
-    for (size_t i = 0; i < N; ++i)
+    // os dois buffers têm o mesmo tamanho e layout: trechos contíguos coincidem
+    framebuffer.forEachSegment(r, [](int y, int x0, int x1, Color *dst)
     {
-        if (overlayMask[i])
-            framebuffer[i] = overlayBuffer[i];
-    }
+        const Color *src = &overlayBuffer.at(x0, y);
+        for (int i = 0; i <= x1 - x0; ++i)
+        {
+            if (src[i].a)
+                dst[i] = src[i];
+        }
+    });
+}
+
+// Limpa a região r do framebuffer com a cor de fundo (memset por linha; um só
+// para a janela inteira)
+void clearFramebufferRegion(const Rect &r)
+{
+    framebuffer.fillRect(r, WHITE);
 }
 
 // Funções utilitárias de pixel / framebuffer
-inline int idx(int x, int y) { return y * winW + x; }
+// Posição de (x,y) na memória de framebuffer e overlayBuffer (mesmo layout)
+inline size_t idx(int x, int y) { return framebuffer.offset(x, y); }
 
 void setPixelBuffer(int x, int y, Color c)
 {
     if (x < 0 || x >= winW || y < 0 || y >= winH)
         return;
-    framebuffer[idx(x, y)] = c;
+    framebuffer.at(x, y) = c;
 }
 
 Color getPixelBuffer(int x, int y)
 {
     if (x < 0 || x >= winW || y < 0 || y >= winH)
         return WHITE;
-    return framebuffer[idx(x, y)];
+    return framebuffer.at(x, y);
 }
 
+// Camada de preview: pixels da forma em construção, mantidos fora do framebuffer.
+// O framebuffer guarda só a cena confirmada (imagem base); o preview é refeito a
+// cada quadro e desenhado por cima dela na apresentação, então mover o cursor
+// não exige recompor nem reenviar a cena.
+struct PreviewLayer
+{
+    SpanList spans; // pixels do preview
+    Color color = RED;
+};
+PreviewLayer previewLayer;
+
+// Quando não nulo, drawPixelGL grava os pixels aqui em vez do framebuffer
+// (cache de spans das formas e camada de preview). Por thread, para que formas
+// diferentes sejam rasterizadas em paralelo.
+thread_local SpanList *pixelCapture = nullptr;
+
 // Desenha pixel usando GL_POINTS
 void drawPixelGL(int x, int y, Color c)
 {
+    if (pixelCapture)
+    {
+        if (x >= 0 && x < winW && y >= 0 && y < winH)
+            pixelCapture->addPixel(x, y);
+        return;
+    }
     // Atualiza buffer auxiliar
     setPixelBuffer(x, y, c);
 }
 
-// Desenha todo o framebuffer na tela (um único batched GL_POINTS)
-void flushFramebuffer()
+// Idem, para pixels já recortados à janela (sem teste de limites)
+inline void drawPixelUnchecked(int x, int y, Color c)
 {
-    glClear(GL_COLOR_BUFFER_BIT);
-    glBegin(GL_POINTS);
-    for (int y = 0; y < winH; ++y)
+    if (pixelCapture)
     {
-        for (int x = 0; x < winW; ++x)
-        {
-            Color c = framebuffer[idx(x, y)];
-            glColor3ub(c.r, c.g, c.b);
-            glVertex2i(x, y);
-        }
+        pixelCapture->addPixel(x, y);
+        return;
+    }
+    framebuffer.at(x, y) = c;
+}
+
+// Trecho horizontal [x0,x1] da linha y, já recortado à janela
+inline void drawRunUnchecked(int y, int x0, int x1, Color c)
+{
+    if (pixelCapture)
+    {
+        pixelCapture->addSpan(y, x0, x1);
+        return;
     }
-    glEnd();
+    framebuffer.fillSpan(y, x0, x1, c);
+}
+
+// Trecho vertical [y0,y1] da coluna x, já recortado à janela
+inline void drawColumnUnchecked(int x, int y0, int y1, Color c)
+{
+    if (pixelCapture)
+    {
+        for (int y = y0; y <= y1; ++y)
+            pixelCapture->addPixel(x, y);
+        return;
+    }
+    framebuffer.fillColumn(x, y0, y1, c);
+}
+
+// Trecho horizontal [x0,x1] da linha y, recortado à janela
+inline void drawRun(int y, int x0, int x1, Color c)
+{
+    if (y < 0 || y >= winH)
+        return;
+    x0 = max(x0, 0);
+    x1 = min(x1, winW - 1);
+    if (x0 <= x1)
+        drawRunUnchecked(y, x0, x1, c);
+}
+
+// Trecho vertical [y0,y1] da coluna x, recortado à janela
+inline void drawColumn(int x, int y0, int y1, Color c)
+{
+    if (x < 0 || x >= winW)
+        return;
+    y0 = max(y0, 0);
+    y1 = min(y1, winH - 1);
+    if (y0 <= y1)
+        drawColumnUnchecked(x, y0, y1, c);
+}
+
+// Desenha todo o framebuffer na tela. O envio é feito de uma vez pelo backend
+// de apresentação (textura, glDrawPixels ou, como fallback, GL_POINTS por pixel)
+void flushFramebuffer()
+{
+    glClear(GL_COLOR_BUFFER_BIT);
+    presentFrame(framebuffer);
+}
+
+// Idem, informando ao backend que só as regiões em dirty mudaram
+void flushFramebuffer(const vector<Rect> &dirty)
+{
+    glClear(GL_COLOR_BUFFER_BIT);
+    presentFrame(framebuffer, dirty);
 }
 
 // Limpa tela (framebuffer + OpenGL)
 void clearScreen()
 {
     // Limpa framebuffer em RAM
-    std::fill(framebuffer.begin(), framebuffer.end(), WHITE);
-    std::fill(overlayBuffer.begin(), overlayBuffer.end(), WHITE);
-    std::fill(overlayMask.begin(), overlayMask.end(), 0);
+    framebuffer.clear(WHITE);
+    overlayBuffer.clear(OVERLAY_EMPTY);
+    damage.clear(); // a imagem inteira foi refeita
     flushFramebuffer();
     glutSwapBuffers();
 }
@@ -202,100 +366,112 @@ void clearScreen()
 // Bresenham (linha)
 // ------------------------
 
-struct OctantFlags
-{
-    bool steep;
-    int x0, y0, x1, y1;
-    int ystep;
-};
-
-OctantFlags computeOctantFlags(int x0, int y0, int x1, int y1)
+// Bresenham geral (utilizando redução ao "primeiro octante" via steep + swap).
+// A linha é recortada à janela antes do laço (clipBresenham): ele começa no
+// primeiro pixel visível, com o termo de erro que teria ali, e só percorre os
+// pixels visíveis, sem teste de limites por pixel. Os pixels saem em trechos
+// (rasterizeBresenham): linhas quase horizontais viram poucos spans, escritos
+// de uma vez, e nas íngremes cada trecho é uma coluna; as quase diagonais
+// seguem pixel a pixel.
+void bresenhamLine(int x0, int y0, int x1, int y1, Color cor)
 {
-    OctantFlags f;
-    f.steep = (abs(y1 - y0) > abs(x1 - x0));
-    if (f.steep)
+    BresenhamClip c;
+    if (!clipBresenham(x0, y0, x1, y1, 0, 0, winW - 1, winH - 1, c))
+        return;
+    int x = c.x, y = c.y; // último pixel, nas coordenadas reduzidas
+    rasterizeBresenham(c, [&](int ry, int rx0, int rx1)
     {
-        swap(x0, y0);
-        swap(x1, y1);
-    }
-    if (x0 > x1)
+        // map back and draw
+        if (c.steep)
+            drawColumnUnchecked(ry, rx0, rx1, cor);
+        else
+            drawRunUnchecked(ry, rx0, rx1, cor);
+        x = rx1;
+        y = ry;
+    }, [&](int ry, int rx)
     {
-        swap(x0, x1);
-        swap(y0, y1);
-    }
-    f.x0 = x0;
-    f.y0 = y0;
-    f.x1 = x1;
-    f.y1 = y1;
-    f.ystep = (y0 < y1) ? 1 : -1;
-    return f;
+        if (c.steep)
+            drawPixelUnchecked(ry, rx, cor);
+        else
+            drawPixelUnchecked(rx, ry, cor);
+        x = rx;
+        y = ry;
+    });
+    // do primeiro ao último pixel visível (a linha é monótona nos dois eixos)
+    if (c.steep)
+        recordDamage(Rect{min(c.y, y), c.x, max(c.y, y), x});
+    else
+        recordDamage(Rect{c.x, min(c.y, y), x, max(c.y, y)});
 }
 
-// Plot um ponto transformando de volta para o sistema original (inverso da redução)
-void plotFromTransformed(int x, int y, const OctantFlags &f, Color cor)
+// ------------------------
+// Círculo: algoritmo de midpoint (variante de Bresenham para círculos)
+// Recebe centro (cx,cy) e raio r
+// ------------------------
+
+// Passos (x, y) do octante de 0 a 45 graus com o mesmo y: x em [xa,xb]. Pela
+// simetria de 8 são 4 trechos horizontais (linhas cy +- y) e 4 verticais
+// (colunas cx +- y), com os mesmos pixels de plotar os 8 pontos de cada passo.
+void plotCircleRuns(int cx, int cy, int xa, int xb, int y, Color cor)
 {
-    int px = x, py = y;
-    if (f.steep)
-        swap(px, py);
-    // No computeOctantFlags garantimos que x0 <= x1; porém se houve swap para ordenar, y may need step inversion
-    // O algoritmo principal já usa ystep para mover em direção correta.
-    drawPixelGL(px, py, cor);
+    drawRun(cy + y, cx + xa, cx + xb, cor);
+    drawRun(cy + y, cx - xb, cx - xa, cor);
+    drawRun(cy - y, cx + xa, cx + xb, cor);
+    drawRun(cy - y, cx - xb, cx - xa, cor);
+    drawColumn(cx + y, cy + xa, cy + xb, cor);
+    drawColumn(cx - y, cy + xa, cy + xb, cor);
+    drawColumn(cx + y, cy - xb, cy - xa, cor);
+    drawColumn(cx - y, cy - xb, cy - xa, cor);
 }
 
-// Bresenham geral (utilizando redução ao "primeiro octante" via steep + swap)
-void bresenhamLine(int x0, int y0, int x1, int y1, Color cor)
+void midpointCircle(int cx, int cy, int r, Color cor)
 {
-    // Special case: degenerate
-    if (x0 == x1 && y0 == y1)
-    {
-        drawPixelGL(x0, y0, cor);
-        return;
-    }
-
-    OctantFlags f = computeOctantFlags(x0, y0, x1, y1);
-    int dx = f.x1 - f.x0;
-    int dy = abs(f.y1 - f.y0);
-    int err = dx / 2;
-    int y = f.y0;
-    for (int x = f.x0; x <= f.x1; ++x)
+    recordDamage(Rect{cx - r, cy - r, cx + r, cy + r});
+    int x = 0, y = r;
+    int d = 1 - r;
+    int xa = 0; // primeiro x com o y atual
+    while (x < y)
     {
-        // map (x,y) back and draw
-        int px = x, py = y;
-        if (f.steep)
-            swap(px, py);
-        drawPixelGL(px, py, cor);
-
-        err -= dy;
-        if (err < 0)
+        if (d < 0)
+        {
+            d += 2 * x + 3;
+            x++;
+        }
+        else
         {
-            y += f.ystep;
-            err += dx;
+            // y vai mudar: os passos xa..x formam um trecho por octante
+            plotCircleRuns(cx, cy, xa, x, y, cor);
+            d += 2 * (x - y) + 5;
+            x++;
+            y--;
+            xa = x;
         }
     }
+    plotCircleRuns(cx, cy, xa, x, y, cor);
 }
 
-// ------------------------
-// Círculo: algoritmo de midpoint (variante de Bresenham para círculos)
-// Recebe centro (cx,cy) e raio r
-// ------------------------
-void plotCirclePoints(int cx, int cy, int x, int y, Color cor)
-{
-    // 8-symmetry
-    drawPixelGL(cx + x, cy + y, cor);
-    drawPixelGL(cx - x, cy + y, cor);
-    drawPixelGL(cx + x, cy - y, cor);
-    drawPixelGL(cx - x, cy - y, cor);
-    drawPixelGL(cx + y, cy + x, cor);
-    drawPixelGL(cx - y, cy + x, cor);
-    drawPixelGL(cx + y, cy - x, cor);
-    drawPixelGL(cx - y, cy - x, cor);
-}
-
-void midpointCircle(int cx, int cy, int r, Color cor)
+// Disco preenchido com as mesmas decisões de midpointCircle, em spans no
+// overlay: a cada passo (x, y) as linhas cy +- x recebem [cx-y, cx+y], e quando y
+// vai mudar as linhas cy +- y recebem [cx-x, cx+x] com o maior x daquele y. Cada
+// linha do disco vai de um extremo ao outro do contorno: O(r) spans, sem
+// percorrer os pixels como o flood fill.
+void fillCircleMidpoint(int cx, int cy, int r, Color cor)
 {
+    if (r < 0)
+        return;
+    Rect box = rectIntersect(Rect{cx - r, cy - r, cx + r, cy + r}, Rect{0, 0, winW - 1, winH - 1});
+    if (box.empty())
+        return;
+    recordDamage(box);
+    auto rows = [&](int k, int half)
+    {
+        fillSpan(cy + k, cx - half, cx + half, cor);
+        if (k != 0)
+            fillSpan(cy - k, cx - half, cx + half, cor);
+    };
     int x = 0, y = r;
     int d = 1 - r;
-    plotCirclePoints(cx, cy, x, y, cor);
+    rows(x, y);
     while (x < y)
     {
         if (d < 0)
@@ -305,11 +481,14 @@ void midpointCircle(int cx, int cy, int r, Color cor)
         }
         else
         {
+            // linhas cy +- y, a não ser que os passos em x ainda cheguem a elas
+            if (y > x + 1)
+                rows(y, x);
             d += 2 * (x - y) + 5;
             x++;
             y--;
         }
-        plotCirclePoints(cx, cy, x, y, cor);
+        rows(x, y);
     }
 }
 
@@ -362,175 +541,341 @@ void drawPolygon(const vector<V2> &pts, Color cor)
 // Scanline Fill para polígonos simples (não necessariamente convexos)
 // Entrada: vetor de vértices em ordem (horária/anti-horária)
 // ------------------------
+// Aresta da tabela de arestas. x é mantido em ponto fixo exato com denominador
+// dy: x = xi + rem/dy, com 0 <= rem < dy. O passo por linha soma dx/dy na mesma
+// representação, sem erro acumulado de ponto flutuante.
 struct Edge
 {
-    int ymax;
-    double x_at_ymin;
-    double inv_slope;
+    int ymin, ymax;
+    int xi, rem;          // parte inteira (floor) e resto de x na linha atual
+    int dy, stepX, stepRem; // dx = stepX * dy + stepRem, 0 <= stepRem < dy
+
+    int xCeil() const { return xi + (rem > 0 ? 1 : 0); }
+    int xFloor() const { return xi; }
+    void step()
+    {
+        xi += stepX;
+        rem += stepRem;
+        if (rem >= dy)
+        {
+            rem -= dy;
+            ++xi;
+        }
+    }
+};
+
+// x(a) < x(b), comparando as frações exatas
+inline bool edgeXLess(const Edge &a, const Edge &b)
+{
+    if (a.xi != b.xi)
+        return a.xi < b.xi;
+    return (long long)a.rem * b.dy < (long long)b.rem * a.dy;
+}
+
+// Contexto reaproveitável do scanline fill: a tabela de arestas (ordenada por
+// ymin, no lugar de um bucket por linha) e as AETs das faixas mantêm a
+// capacidade entre chamadas, então preenchimentos em regime não alocam memória.
+//
+// lastAllocations conta as realocações destes buffers: cada um é reservado no
+// início da chamada até o seu limite (vértices, arestas, faixas), então cresce
+// no máximo uma vez e nada cresce depois. Não entram alocações fora do
+// contexto (registro de dano, overlay); parallelFor não aloca (ParallelBody).
+struct ScanlineFillContext
+{
+    vector<IPoint> clipIn, clipOut, clipTmp; // polígono antes, depois e durante o recorte
+    vector<Edge> edges;
+    vector<vector<Edge>> bandAet; // uma AET por faixa de linhas
+    bool parallel = true;         // faixas preenchidas em paralelo
+
+    // contadores
+    unsigned long calls = 0;
+    unsigned long lastAllocations = 0, totalAllocations = 0;
+    double lastMs = 0.0, totalMs = 0.0;
 };
 
+// Reserva n elementos em v, contando em allocs se isso realocou
+template <class T>
+void reserveCounted(vector<T> &v, size_t n, unsigned long &allocs)
+{
+    if (v.capacity() >= n)
+        return;
+    v.reserve(n);
+    ++allocs;
+}
+ScanlineFillContext fillCtx;
+
+inline int floorDiv(int a, int b) // b > 0
+{
+    int q = a / b;
+    if ((a % b) != 0 && a < 0)
+        --q;
+    return q;
+}
+
+// posiciona a aresta na linha y (ymin <= y): x(y) exato, sem passar linha a linha
+inline void advanceEdgeTo(Edge &e, int y)
+{
+    long long s = (long long)(y - e.ymin);
+    long long acc = e.rem + s * e.stepRem;
+    e.xi += (int)(s * e.stepX + acc / e.dy);
+    e.rem = (int)(acc % e.dy);
+}
+
+// Preenche as linhas [y0,y1] do polígono. A AET é montada direto em y0 (arestas
+// com ymin <= y0 < ymax, avançadas até y0), então cada faixa começa no meio do
+// polígono sem depender das anteriores e escreve só nas suas linhas.
+void fillScanlineBand(const vector<Edge> &edges, vector<Edge> &AET, int y0, int y1, Color cor)
+{
+    AET.clear();
+    size_t next = upper_bound(edges.begin(), edges.end(), y0, [](int y, const Edge &e)
+                              { return y < e.ymin; }) - edges.begin();
+    for (size_t i = 0; i < next; ++i)
+    {
+        if (edges[i].ymax <= y0)
+            continue;
+        AET.push_back(edges[i]);
+        advanceEdgeTo(AET.back(), y0);
+    }
+    sort(AET.begin(), AET.end(), edgeXLess);
+
+    for (int scan = y0; scan <= y1; ++scan)
+    {
+        // adiciona arestas iniciando neste scanline
+        while (next < edges.size() && edges[next].ymin == scan)
+            AET.push_back(edges[next++]);
+        // remove arestas cujo ymax == scan (compactação estável, preserva a ordem)
+        size_t k = 0;
+        for (size_t i = 0; i < AET.size(); ++i)
+            if (AET[i].ymax > scan)
+                AET[k++] = AET[i];
+        AET.resize(k);
+        // a AET fica quase ordenada de uma linha para a outra: ordenação por inserção
+        for (size_t i = 1; i < AET.size(); ++i)
+        {
+            Edge e = AET[i];
+            size_t j = i;
+            while (j > 0 && edgeXLess(e, AET[j - 1]))
+            {
+                AET[j] = AET[j - 1];
+                --j;
+            }
+            AET[j] = e;
+        }
+
+        // preencher pares (paridade) - cada par = intervalo de preenchimento
+        for (size_t i = 0; i + 1 < AET.size(); i += 2)
+        {
+            fillSpan(scan, AET[i].xCeil(), AET[i + 1].xFloor(), cor);
+        }
+
+        // incrementar x para cada aresta: x = x + dx/dy
+        for (auto &e : AET)
+            e.step();
+    }
+}
+
 void fillPolygonScanline(const vector<V2> &verts, Color cor)
 {
     if (verts.size() < 3)
         return;
-    // Encontrar ymin e ymax (em y inteiro)
-    int ymin = verts[0].y, ymax = verts[0].y;
+    auto t0 = std::chrono::steady_clock::now();
+    ScanlineFillContext &ctx = fillCtx;
+    unsigned long allocs = 0;
+
+    // Recorta à janela antes da tabela de arestas (Sutherland-Hodgman sem
+    // vértices de interseção, ver clipping.h): as partes fora da tela viram no
+    // máximo duas pontas por saída, e os pixels preenchidos não mudam. O
+    // recorte nunca aumenta o número de vértices nem o de arestas.
+    reserveCounted(ctx.clipIn, verts.size(), allocs);
+    reserveCounted(ctx.clipOut, verts.size(), allocs);
+    reserveCounted(ctx.clipTmp, verts.size(), allocs);
+    reserveCounted(ctx.edges, verts.size(), allocs);
+    ctx.clipIn.clear();
     for (auto &v : verts)
+        ctx.clipIn.push_back(IPoint(v.x, v.y));
+    clipPolygonForFill(ctx.clipIn, 0, 0, winW - 1, winH - 1, ctx.clipOut, ctx.clipTmp);
+    const vector<IPoint> &poly = ctx.clipOut;
+
+    // Encontrar ymin e ymax (em y inteiro)
+    int ymin = INT_MAX, ymax = INT_MIN;
+    int xmin = INT_MAX, xmax = INT_MIN;
+    for (auto &v : poly)
     {
-        ymin = min(ymin, v.y);
-        ymax = max(ymax, v.y);
+        ymin = min(ymin, v.second);
+        ymax = max(ymax, v.second);
+        xmin = min(xmin, v.first);
+        xmax = max(xmax, v.first);
     }
+    if (!poly.empty())
+        recordDamage(Rect{xmin, ymin, xmax, ymax});
 
-    // Table de lista de arestas (bucket) por y
-    int H = ymax - ymin + 1;
-    vector<vector<Edge>> buckets(H);
-
-    size_t n = verts.size();
+    // Tabela de arestas, ordenada por ymin
+    ctx.edges.clear();
+    size_t n = poly.size();
     for (size_t i = 0; i < n; ++i)
     {
-        V2 v1 = verts[i];
-        V2 v2 = verts[(i + 1) % n];
+        V2 v1 = {poly[i].first, poly[i].second};
+        V2 v2 = {poly[(i + 1) % n].first, poly[(i + 1) % n].second};
         if (v1.y == v2.y)
             continue; // ignora arestas horizontais
         V2 ymin_v = v1.y < v2.y ? v1 : v2;
         V2 ymax_v = v1.y < v2.y ? v2 : v1;
         Edge e;
+        e.ymin = ymin_v.y;
         e.ymax = ymax_v.y;
-        e.x_at_ymin = ymin_v.x;
-        e.inv_slope = double(ymax_v.x - ymin_v.x) / double(ymax_v.y - ymin_v.y); // dx/dy
-        int index = ymin_v.y - ymin;
-        if (index >= 0 && index < H)
-            buckets[index].push_back(e);
+        e.xi = ymin_v.x;
+        e.rem = 0;
+        e.dy = ymax_v.y - ymin_v.y;
+        int dx = ymax_v.x - ymin_v.x;
+        e.stepX = floorDiv(dx, e.dy);
+        e.stepRem = dx - e.stepX * e.dy;
+        ctx.edges.push_back(e);
     }
-
-    vector<Edge> AET; // active edge table
-    // scanline varre da ymin até ymax-1
-    for (int scan = ymin; scan <= ymax; ++scan)
+    sort(ctx.edges.begin(), ctx.edges.end(), [](const Edge &a, const Edge &b)
+         { return a.ymin < b.ymin; });
+
+    // Só as linhas dentro da janela geram spans. Faixas de pelo menos
+    // SCAN_BAND_MIN_ROWS linhas, no máximo uma por thread, preenchidas em
+    // paralelo: cada uma escreve em linhas distintas do overlay, sem trava.
+    const int SCAN_BAND_MIN_ROWS = 64;
+    int y0 = max(ymin, 0), y1 = min(ymax, winH - 1);
+    int rows = y1 >= y0 ? y1 - y0 + 1 : 0; // 0: polígono fora da janela
+    size_t nb = 1;
+    if (ctx.parallel && rows > 0)
+        nb = min<size_t>(threadPoolSize(), (size_t)max(1, rows / SCAN_BAND_MIN_ROWS));
+    // cada AET tem no máximo todas as arestas
+    if (ctx.bandAet.size() < nb)
     {
-        int idx_bucket = scan - ymin;
-        if (idx_bucket >= 0 && idx_bucket < H)
-        {
-            // adiciona arestas iniciando neste scanline
-            for (auto &e : buckets[idx_bucket])
-                AET.push_back(e);
-        }
-        // remove arestas cujo ymax == scan
-        AET.erase(remove_if(AET.begin(), AET.end(), [scan](const Edge &e)
-                            { return e.ymax <= scan; }),
-                  AET.end());
-        // ordenar AET por x_at_ymin
-        sort(AET.begin(), AET.end(), [](const Edge &a, const Edge &b)
-             { return a.x_at_ymin < b.x_at_ymin; });
-
-        // preencher pares (paridade) - cada par = intervalo de preenchimento
-        for (size_t i = 0; i + 1 < AET.size(); i += 2)
-        {
-            int x_start = (int)ceil(AET[i].x_at_ymin);
-            int x_end = (int)floor(AET[i + 1].x_at_ymin);
-            for (int x = x_start; x <= x_end; ++x)
-            {
-                setOverlayPixel(x, scan, cor);
-            }
-        }
-
-        // incrementar x para cada aresta: x = x + inv_slope
-        for (auto &e : AET)
-        {
-            e.x_at_ymin += e.inv_slope;
-        }
-        // atualizar AET: copy back with updated xs
-        // Note: above we updated 'e' on a copy; we need to update items in vector.
-        // We'll implement properly: we must iterate via index
-        for (size_t k = 0; k < AET.size(); ++k)
-        {
-            // nothing: already updated via reference in the previous loop? To be safe, we redo.
-        }
-        // To ensure correct updates, rebuild AET: (simpler approach)
-        for (auto &e : AET)
+        reserveCounted(ctx.bandAet, nb, allocs);
+        ctx.bandAet.resize(nb);
+    }
+    for (size_t b = 0; b < nb; ++b)
+        reserveCounted(ctx.bandAet[b], ctx.edges.size(), allocs);
+    if (rows > 0)
+    {
+        parallelFor(nb, [&](size_t b)
         {
-            // no-op
-        }
-        // But because we used for(auto &e: AET) earlier, e.x_at_ymin was updated properly.
+            int by0 = y0 + (int)((long long)rows * b / nb);
+            int by1 = y0 + (int)((long long)rows * (b + 1) / nb) - 1;
+            fillScanlineBand(ctx.edges, ctx.bandAet[b], by0, by1, cor);
+        });
     }
+
+    ctx.lastAllocations = allocs;
+    ctx.totalAllocations += ctx.lastAllocations;
+    ctx.lastMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    ctx.totalMs += ctx.lastMs;
+    ++ctx.calls;
 }
 
 // ------------------------
 // Flood-fill
 // ------------------------
-bool colorEqual(const Color &a, const Color &b)
-{
-    return a.r == b.r && a.g == b.g && a.b == b.b;
-}
 
-// Flood fill eficiente usando BFS (fila) para evitar stack overflow e melhorar performance
-// Utiliza um buffer auxiliar de visitados para evitar múltiplos acessos ao mesmo pixel
+// Flood fill por spans (scanline seed fill): cada semente é expandida para a
+// esquerda e a direita até as barreiras, a corrida inteira é pintada de uma vez
+// e só uma semente por corrida contígua é empilhada nas linhas acima e abaixo.
+// Mesma vizinhança 4 e mesmas barreiras do BFS original: um pixel é atravessável
+// se a cor do framebuffer e a cor combinada (com overlay) são iguais à cor alvo.
+// Como os pixels pintados passam a ter a nova cor (≠ alvo) no overlay, eles
+// deixam de ser atravessáveis, o que dispensa o buffer de visitados.
 void floodFill4(int sx, int sy, Color newColor)
 {
     if (sx < 0 || sx >= winW || sy < 0 || sy >= winH)
         return;
     Color target = getCombinedPixel(sx, sy);
-    if (colorEqual(target, newColor))
+    if (target == newColor)
         return;
 
-    // Buffer de visitados (dinâmico, 1 byte por pixel)
-    std::vector<unsigned char> visited(winW * winH, 0);
-    std::queue<V2> q;
-    q.push({sx, sy});
-    visited[idx(sx, sy)] = 1;
+    auto t0 = std::chrono::steady_clock::now();
+    // comparações de 32 bits; overlay vazio (alfa 0) não bloqueia
+    const Color *base = framebuffer.data();
+    const Color *over = overlayBuffer.data();
+    auto passable = [&](int x, int y)
+    {
+        size_t i = idx(x, y);
+        return base[i] == target && (over[i].a == 0 || over[i] == target);
+    };
 
-    // Direções: direita, esquerda, cima, baixo
-    const int dx[4] = {1, -1, 0, 0};
-    const int dy[4] = {0, 0, 1, -1};
+    // Pilha de sementes reaproveitada entre chamadas (sem alocação por clique)
+    static vector<V2> seeds;
+    seeds.clear();
+    long long filledPixels = 0;
+    Rect filled = Rect{sx, sy, sx, sy};
 
-    while (!q.empty())
+    // A semente é sempre pintada, mesmo sob uma aresta (comportamento do BFS original)
+    if (!passable(sx, sy))
     {
-        V2 p = q.front();
-        q.pop();
-        int x = p.x, y = p.y;
-        setOverlayPixel(x, y, newColor);
+        setOverlayPixel(sx, sy, newColor);
+        ++filledPixels;
+        seeds.push_back({sx + 1, sy});
+        seeds.push_back({sx - 1, sy});
+        seeds.push_back({sx, sy + 1});
+        seeds.push_back({sx, sy - 1});
+    }
+    else
+        seeds.push_back({sx, sy});
 
-        for (int d = 0; d < 4; ++d)
+    // empilha uma semente por corrida atravessável de [x0,x1] na linha y
+    auto scanRow = [&](int y, int x0, int x1)
+    {
+        if (y < 0 || y >= winH)
+            return;
+        int x = x0;
+        while (x <= x1)
         {
-            int nx = x + dx[d];
-            int ny = y + dy[d];
-            if (nx < 0 || nx >= winW || ny < 0 || ny >= winH)
-                continue;
-            int i = idx(nx, ny);
-            if (visited[i])
-                continue;
-            Color c_combined = getCombinedPixel(nx, ny);
-            Color c_frame = getPixelBuffer(nx, ny);
-            // Só avança se o pixel não for barreira (ou seja, se a cor do framebuffer for igual à cor alvo)
-            if (!colorEqual(c_frame, target))
-                continue;
-            if (colorEqual(c_combined, target))
-            {
-                q.push({nx, ny});
-                visited[i] = 1;
-            }
+            while (x <= x1 && !passable(x, y))
+                ++x;
+            if (x > x1)
+                break;
+            seeds.push_back({x, y});
+            while (x <= x1 && passable(x, y))
+                ++x;
         }
+    };
+
+    while (!seeds.empty())
+    {
+        V2 p = seeds.back();
+        seeds.pop_back();
+        if (p.x < 0 || p.x >= winW || p.y < 0 || p.y >= winH)
+            continue;
+        if (!passable(p.x, p.y))
+            continue; // já pintado por outra corrida
+        int xl = p.x, xr = p.x;
+        while (xl > 0 && passable(xl - 1, p.y))
+            --xl;
+        while (xr < winW - 1 && passable(xr + 1, p.y))
+            ++xr;
+        fillSpan(p.y, xl, xr, newColor);
+        filledPixels += xr - xl + 1;
+        filled = rectUnion(filled, Rect{xl, p.y, xr, p.y});
+        scanRow(p.y + 1, xl, xr);
+        scanRow(p.y - 1, xl, xr);
     }
+    recordDamage(filled);
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    snprintf(fillInfo, sizeof(fillInfo), "Flood fill: %lld pixels em %.2f ms", filledPixels, ms);
 }
 
 // ------------------------
 // Transformações geométricas (matriz 3x3) aplicadas a um conjunto de vértices.
 // Utilizamos coordenadas homogêneas (x, y, 1). As transformações retornam
-// um novo vetor de V2 com coordenadas arredondadas.
+// um novo vetor de V2 com coordenadas arredondadas. Mat3 e o kernel SIMD em
+// lote (mesmo arredondamento de round()) vêm de batchtransform.h.
 // ------------------------
-using Mat3 = array<array<double, 3>, 3>;
-
 vector<V2> applyTransform(const vector<V2> &pts, const Mat3 &M)
 {
-    vector<V2> out;
-    out.reserve(pts.size());
+    // ignoramos componente homogênea porque M[2][*] = [0,0,1]
+    static thread_local VertexSoA soa;
+    soa.clear();
     for (auto &p : pts)
-    {
-        double x = p.x, y = p.y;
-        double nx = M[0][0] * x + M[0][1] * y + M[0][2] * 1.0;
-        double ny = M[1][0] * x + M[1][1] * y + M[1][2] * 1.0;
-        // ignoramos componente homogênea porque M[2][*] = [0,0,1]
-        out.push_back({(int)round(nx), (int)round(ny)});
-    }
+        soa.push(p.x, p.y);
+    transformBatch(soa, M);
+    vector<V2> out(pts.size());
+    for (size_t i = 0; i < pts.size(); ++i)
+        out[i] = {soa.x[i], soa.y[i]};
     return out;
 }
 
@@ -583,11 +928,33 @@ Mat3 reflectMat(bool reflectX, bool reflectY)
     return M;
 }
 
-// Aplica transformação em relação ao centro (centroid) da forma
-vector<V2> transformAboutCenter(const vector<V2> &pts, const Mat3 &M)
+// Produto de matrizes A * B (aplica B e depois A)
+Mat3 mulMat(const Mat3 &A, const Mat3 &B)
 {
-    // compute centroid (average)
-    double cx = 0, cy = 0;
+    Mat3 C;
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            C[i][j] = 0;
+            for (int k = 0; k < 3; k++)
+                C[i][j] += A[i][k] * B[k][j];
+        }
+    }
+    return C;
+}
+
+// M em torno do ponto (cx, cy): T(c) * M * T(-c)
+Mat3 aboutPointMat(const Mat3 &M, double cx, double cy)
+{
+    return mulMat(translateMat(cx, cy), mulMat(M, translateMat(-cx, -cy)));
+}
+
+// Centroide (média) dos vértices, em double
+void centroid(const vector<V2> &pts, double &cx, double &cy)
+{
+    cx = 0;
+    cy = 0;
     for (auto &p : pts)
     {
         cx += p.x;
@@ -595,124 +962,722 @@ vector<V2> transformAboutCenter(const vector<V2> &pts, const Mat3 &M)
     }
     cx /= pts.size();
     cy /= pts.size();
-    Mat3 T1 = translateMat(-cx, -cy);
-    Mat3 T2 = translateMat(cx, cy);
-    // compose T2 * M * T1
-    Mat3 TMP = identityMat();
-    // TMP = M * T1
-    for (int i = 0; i < 3; i++)
+}
+
+// Aplica transformação em relação ao centro (centroid) da forma
+vector<V2> transformAboutCenter(const vector<V2> &pts, const Mat3 &M)
+{
+    double cx, cy;
+    centroid(pts, cx, cy);
+    return applyTransform(pts, aboutPointMat(M, cx, cy));
+}
+
+bool Forma::transformed() const
+{
+    return xform != identityMat();
+}
+
+// O retângulo guarda só 2 cantos opostos, que continuam definindo a caixa sob
+// escala, translação, reflexão e giros de 90 graus. Sob rotação qualquer ou
+// cisalhamento isso deixa de valer: os 4 cantos são transformados e a forma é
+// desenhada e testada como um polígono de 4 vértices.
+bool Forma::rectAsPolygon() const
+{
+    if (tipo != M_RETANGULO || verts.size() < 2)
+        return false;
+    bool keepsAxes = (xform[0][1] == 0 && xform[1][0] == 0) || (xform[0][0] == 0 && xform[1][1] == 0);
+    return !keepsAxes;
+}
+
+// Os 4 cantos do retângulo de cantos opostos a e b, em ordem ao redor dele
+vector<V2> rectCorners(V2 a, V2 b)
+{
+    return {a, {b.x, a.y}, b, {a.x, b.y}};
+}
+
+// Vértices na tela: os originais, ou xform aplicada a eles (calculada uma vez
+// por mudança; resolveFormas faz o mesmo para várias formas num lote só)
+const vector<V2> &Forma::pts() const
+{
+    if (!transformed())
+        return verts;
+    if (!worldValid)
     {
-        for (int j = 0; j < 3; j++)
+        world = applyTransform(rectAsPolygon() ? rectCorners(verts[0], verts[1]) : verts, xform);
+        worldValid = true;
+    }
+    return world;
+}
+
+// ------------------------
+// Funções de desenho / redesenho de todas as formas na tela
+// ------------------------
+
+// Rasteriza uma forma confirmada no framebuffer
+void drawForma(const Forma &f)
+{
+    const vector<V2> &P = f.pts();
+    switch (f.tipo)
+    {
+    case M_LINHA:
+        if (P.size() >= 2)
+            bresenhamLine(P[0].x, P[0].y, P[1].x, P[1].y, f.cor);
+        break;
+    case M_RETANGULO:
+        if (P.size() >= 4)
+            drawPolygon(P, f.cor); // girado ou cisalhado (rectAsPolygon)
+        else if (P.size() >= 2)
+            drawRectFromCorners(P[0].x, P[0].y, P[1].x, P[1].y, f.cor);
+        break;
+    case M_TRIANGULO:
+        if (P.size() >= 3)
+            drawTriangle(P, f.cor);
+        break;
+    case M_POLIGONO:
+        if (P.size() >= 3)
+            drawPolygon(P, f.cor);
+        break;
+    case M_CIRCULO:
+        if (P.size() >= 2)
         {
-            TMP[i][j] = 0;
-            for (int k = 0; k < 3; k++)
-                TMP[i][j] += M[i][k] * T1[k][j];
+            int cx = P[0].x, cy = P[0].y;
+            int dx = P[1].x - cx;
+            int dy = P[1].y - cy;
+            int r = (int)round(sqrt(dx * dx + dy * dy));
+            midpointCircle(cx, cy, r, f.cor);
         }
+        break;
     }
-    Mat3 COM = identityMat();
-    for (int i = 0; i < 3; i++)
+}
+
+// Caixa envolvente dos pixels que drawForma pode tocar
+Rect formaBounds(const Forma &f)
+{
+    const vector<V2> &P = f.pts();
+    if (P.empty())
+        return emptyRect();
+    if (f.tipo == M_CIRCULO)
     {
-        for (int j = 0; j < 3; j++)
+        if (P.size() < 2)
+            return emptyRect();
+        int cx = P[0].x, cy = P[0].y;
+        int dx = P[1].x - cx;
+        int dy = P[1].y - cy;
+        int r = (int)round(sqrt(dx * dx + dy * dy));
+        return Rect{cx - r, cy - r, cx + r, cy + r};
+    }
+    Rect b = Rect{P[0].x, P[0].y, P[0].x, P[0].y};
+    for (auto &v : P)
+        b = rectUnion(b, Rect{v.x, v.y, v.x, v.y});
+    return b;
+}
+
+// Caixa usada no índice espacial: a da forma, com a folga do clique
+Rect pickBounds(const Forma &f)
+{
+    Rect b = formaBounds(f);
+    if (b.empty())
+        return b;
+    return Rect{b.x0 - PICK_TOLERANCE, b.y0 - PICK_TOLERANCE, b.x1 + PICK_TOLERANCE, b.y1 + PICK_TOLERANCE};
+}
+
+// Refaz o índice inteiro (transformação de todas as formas, nova janela)
+void rebuildFormaIndex()
+{
+    formaIndex.reset(winW, winH);
+    for (size_t i = 0; i < formas.size(); ++i)
+        formaIndex.insert((uint32_t)i, pickBounds(formas[i]));
+}
+
+// Remove todas as formas confirmadas (e a seleção)
+void clearFormas()
+{
+    formas.clear();
+    formaIndex.clear();
+    selectedForma = -1;
+}
+
+// Rasteriza a forma no seu cache de spans. Só usa estado por thread
+// (pixelCapture/damageRecorder), então formas diferentes podem ser
+// rasterizadas ao mesmo tempo.
+void rasterizeToCache(const Forma &f)
+{
+    DamageTracker *saved = damageRecorder;
+    damageRecorder = nullptr;
+    f.cache.spans.clear();
+    pixelCapture = &f.cache.spans;
+    drawForma(f);
+    pixelCapture = nullptr;
+    damageRecorder = saved;
+    f.cache.spans.normalize();
+    f.cache.bounds = f.cache.spans.bounds();
+    f.cache.valid = true;
+}
+
+// Garante o cache de spans da forma, rasterizando-a só se estiver inválido
+const SpanCache &ensureCached(const Forma &f)
+{
+    if (f.cache.valid)
+    {
+        ++cacheStats.frameHits;
+        ++cacheStats.totalHits;
+        return f.cache;
+    }
+    rasterizeToCache(f);
+    ++cacheStats.frameRasterizations;
+    ++cacheStats.totalRasterizations;
+    return f.cache;
+}
+
+// Reproduz no framebuffer os spans em cache da forma, recortados a r
+void replayCached(const SpanCache &c, Color cor, const Rect &r)
+{
+    size_t first, last;
+    c.spans.rowRange(r.y0, r.y1, first, last);
+    for (size_t i = first; i < last; ++i)
+    {
+        const Span &sp = c.spans.spans[i];
+        int x0 = max(sp.x0, r.x0), x1 = min(sp.x1, r.x1);
+        if (x0 > x1)
+            continue;
+        framebuffer.fillSpan(sp.y, x0, x1, cor);
+    }
+}
+
+// Confirma uma forma: entra na lista e marca sua região para redesenho
+void addForma(const Forma &f)
+{
+    formas.push_back(f);
+    damage.add(ensureCached(formas.back()).bounds);
+    formaIndex.insert((uint32_t)(formas.size() - 1), pickBounds(formas.back()));
+}
+
+// Calcula os vértices na tela de todas as formas com xform pendente num único
+// buffer SoA: cada forma ocupa um intervalo e é transformada pelo kernel em lote
+// com a sua própria matriz
+void resolveFormas()
+{
+    static VertexSoA soa;
+    static vector<size_t> firsts;
+    soa.clear();
+    firsts.clear();
+    for (const auto &f : formas)
+    {
+        firsts.push_back(soa.size());
+        if (f.worldValid || !f.transformed())
+            continue;
+        if (f.rectAsPolygon())
         {
-            COM[i][j] = 0;
-            for (int k = 0; k < 3; k++)
-                COM[i][j] += T2[i][k] * TMP[k][j];
+            for (const auto &v : rectCorners(f.verts[0], f.verts[1]))
+                soa.push(v.x, v.y);
+            continue;
         }
+        for (const auto &v : f.verts)
+            soa.push(v.x, v.y);
     }
-    return applyTransform(pts, COM);
+    firsts.push_back(soa.size());
+    for (size_t i = 0; i < formas.size(); ++i)
+    {
+        const Forma &f = formas[i];
+        if (f.worldValid || !f.transformed())
+            continue;
+        size_t first = firsts[i], n = firsts[i + 1] - first;
+        transformBatch(soa, f.xform, first, n);
+        f.world.resize(n);
+        for (size_t k = 0; k < n; ++k)
+            f.world[k] = {soa.x[first + k], soa.y[first + k]};
+        f.worldValid = true;
+    }
+}
+
+// Aplica M à forma (em torno do centro atual): só compõe a matriz. O centro é o
+// centroide dos originais levado por xform, em double, então não deriva com o
+// arredondamento dos vértices. A região antiga e a nova são redesenhadas.
+void transformForma(Forma &f, const Mat3 &M)
+{
+    if (f.verts.empty())
+        return;
+    damage.add(f.cache.valid ? f.cache.bounds : formaBounds(f));
+    double ox, oy;
+    centroid(f.verts, ox, oy);
+    double cx = f.xform[0][0] * ox + f.xform[0][1] * oy + f.xform[0][2];
+    double cy = f.xform[1][0] * ox + f.xform[1][1] * oy + f.xform[1][2];
+    f.xform = mulMat(aboutPointMat(M, cx, cy), f.xform);
+    f.invalidateCache();
+    damage.add(formaBounds(f));
+    formaIndex.update((uint32_t)(&f - formas.data()), pickBounds(f));
+}
+
+// Aplica M (sem centro) a todas as formas confirmadas: compõe as matrizes e
+// resolve os vértices de todas num lote só (resolveFormas)
+void transformAllFormas(const Mat3 &M)
+{
+    for (auto &f : formas)
+    {
+        damage.add(f.cache.valid ? f.cache.bounds : formaBounds(f));
+        f.xform = mulMat(M, f.xform);
+        f.invalidateCache();
+    }
+    resolveFormas();
+    for (const auto &f : formas)
+        damage.add(formaBounds(f));
+    rebuildFormaIndex();
 }
 
 // ------------------------
-// Funções de desenho / redesenho de todas as formas na tela
+// Seleção: teste exato de uma forma contra um ponto
 // ------------------------
-void redrawAll()
-{
-    // Limpa framebuffer em RAM
-    std::fill(framebuffer.begin(), framebuffer.end(), WHITE);
 
-    // Primeiro aplica o overlay (preenchimentos) no framebuffer
-    applyOverlayToFramebuffer();
+// Quadrado da distância de (px,py) ao segmento a-b
+double segDist2(double px, double py, V2 a, V2 b)
+{
+    double dx = b.x - a.x, dy = b.y - a.y;
+    double ex = px - a.x, ey = py - a.y;
+    double len2 = dx * dx + dy * dy;
+    double t = len2 > 0 ? (ex * dx + ey * dy) / len2 : 0.0;
+    t = max(0.0, min(1.0, t));
+    ex -= t * dx;
+    ey -= t * dy;
+    return ex * ex + ey * ey;
+}
 
-    // Depois desenha todas as formas (arestas) por cima do framebuffer já preenchido
-    for (const auto &f : formas)
+// Ponto no polígono (regra par-ímpar, mesma do scanline fill)
+bool pointInPolygon(const vector<V2> &pts, double px, double py)
+{
+    bool inside = false;
+    for (size_t i = 0, j = pts.size() - 1; i < pts.size(); j = i++)
     {
-        switch (f.tipo)
+        const V2 &a = pts[i], &b = pts[j];
+        if ((a.y > py) != (b.y > py))
         {
-        case M_LINHA:
-            if (f.verts.size() >= 2)
-                bresenhamLine(f.verts[0].x, f.verts[0].y, f.verts[1].x, f.verts[1].y, f.cor);
-            break;
-        case M_RETANGULO:
-            if (f.verts.size() >= 2)
-                drawRectFromCorners(f.verts[0].x, f.verts[0].y, f.verts[1].x, f.verts[1].y, f.cor);
-            break;
-        case M_TRIANGULO:
-            if (f.verts.size() >= 3)
-                drawTriangle(f.verts, f.cor);
-            break;
-        case M_POLIGONO:
-            if (f.verts.size() >= 3)
-                drawPolygon(f.verts, f.cor);
-            break;
-        case M_CIRCULO:
-            if (f.verts.size() >= 2)
-            {
-                int cx = f.verts[0].x, cy = f.verts[0].y;
-                int dx = f.verts[1].x - cx;
-                int dy = f.verts[1].y - cy;
-                int r = (int)round(sqrt(dx * dx + dy * dy));
-                midpointCircle(cx, cy, r, f.cor);
-            }
-            break;
+            double xc = a.x + (py - a.y) * (double)(b.x - a.x) / (b.y - a.y);
+            if (px < xc)
+                inside = !inside;
         }
     }
+    return inside;
+}
 
-    // Desenha preview da forma em desenho, se houver
-    if (drawing)
+// O ponto acerta o polígono fechado: perto de uma aresta ou dentro dele
+bool hitPolygon(const vector<V2> &P, int x, int y)
+{
+    const double tol2 = (double)PICK_TOLERANCE * PICK_TOLERANCE;
+    for (size_t i = 0, j = P.size() - 1; i < P.size(); j = i++)
+        if (segDist2(x, y, P[j], P[i]) <= tol2)
+            return true;
+    return pointInPolygon(P, x + 0.5, y + 0.5);
+}
+
+// O ponto acerta a forma: a até PICK_TOLERANCE do contorno ou, nas formas
+// fechadas, dentro delas
+bool hitForma(const Forma &f, int x, int y)
+{
+    const vector<V2> &P = f.pts();
+    const double tol2 = (double)PICK_TOLERANCE * PICK_TOLERANCE;
+    switch (f.tipo)
+    {
+    case M_LINHA:
+        return P.size() >= 2 && segDist2(x, y, P[0], P[1]) <= tol2;
+    case M_RETANGULO:
+    {
+        if (P.size() >= 4) // girado ou cisalhado: mesmo teste do polígono
+            return hitPolygon(P, x, y);
+        if (P.size() < 2)
+            return false;
+        // mesmo retângulo alinhado aos eixos de drawRectFromCorners
+        int left = min(P[0].x, P[1].x), right = max(P[0].x, P[1].x);
+        int bottom = min(P[0].y, P[1].y), top = max(P[0].y, P[1].y);
+        return x >= left - PICK_TOLERANCE && x <= right + PICK_TOLERANCE &&
+               y >= bottom - PICK_TOLERANCE && y <= top + PICK_TOLERANCE;
+    }
+    case M_TRIANGULO:
+    case M_POLIGONO:
+        return P.size() >= 3 && hitPolygon(P, x, y);
+    case M_CIRCULO:
+    {
+        if (P.size() < 2)
+            return false;
+        int cx = P[0].x, cy = P[0].y;
+        int dx = P[1].x - cx, dy = P[1].y - cy;
+        double r = round(sqrt(dx * dx + dy * dy));
+        double ex = x - cx, ey = y - cy;
+        return sqrt(ex * ex + ey * ey) <= r + PICK_TOLERANCE;
+    }
+    }
+    return false;
+}
+
+// Forma mais acima (a última confirmada) sob (x,y), ou -1. O índice espacial
+// devolve só as candidatas cuja caixa contém o ponto; elas são testadas da mais
+// recente para a mais antiga (heap: não é preciso ordenar todas) e a primeira
+// que passa no teste exato é a escolhida.
+int pickForma(int x, int y)
+{
+    static vector<uint32_t> candidates;
+    formaIndex.query(x, y, candidates);
+    make_heap(candidates.begin(), candidates.end());
+    while (!candidates.empty())
+    {
+        pop_heap(candidates.begin(), candidates.end());
+        uint32_t i = candidates.back();
+        candidates.pop_back();
+        if (hitForma(formas[i], x, y))
+            return (int)i;
+    }
+    return -1;
+}
+
+// Referência sem índice: percorre todas as formas de cima para baixo
+int pickFormaLinear(int x, int y)
+{
+    for (size_t i = formas.size(); i-- > 0;)
+        if (hitForma(formas[i], x, y))
+            return (int)i;
+    return -1;
+}
+
+// Desenha o preview (em vermelho) da forma em construção até o cursor
+void drawPreview()
+{
+    Color previewColor = previewLayer.color; // cor do preview
+    switch (currentForma.tipo)
     {
-        Color previewColor = RED; // cor do preview
-        switch (currentForma.tipo)
+    case M_LINHA:
+        if (currentForma.verts.size() >= 1)
+            bresenhamLine(currentForma.verts[0].x, currentForma.verts[0].y, mouse_x, mouse_y, previewColor);
+        break;
+    case M_RETANGULO:
+        if (currentForma.verts.size() >= 1)
+            drawRectFromCorners(currentForma.verts[0].x, currentForma.verts[0].y, mouse_x, mouse_y, previewColor);
+        break;
+    case M_TRIANGULO:
+        if (currentForma.verts.size() == 1)
+            bresenhamLine(currentForma.verts[0].x, currentForma.verts[0].y, mouse_x, mouse_y, previewColor);
+        else if (currentForma.verts.size() == 2)
+        {
+            bresenhamLine(currentForma.verts[0].x, currentForma.verts[0].y, currentForma.verts[1].x, currentForma.verts[1].y, previewColor);
+            bresenhamLine(currentForma.verts[1].x, currentForma.verts[1].y, mouse_x, mouse_y, previewColor);
+        }
+        break;
+    case M_POLIGONO:
+        if (currentForma.verts.size() >= 1)
         {
-        case M_LINHA:
-            if (currentForma.verts.size() >= 1)
-                bresenhamLine(currentForma.verts[0].x, currentForma.verts[0].y, mouse_x, mouse_y, previewColor);
-            break;
-        case M_RETANGULO:
-            if (currentForma.verts.size() >= 1)
-                drawRectFromCorners(currentForma.verts[0].x, currentForma.verts[0].y, mouse_x, mouse_y, previewColor);
-            break;
-        case M_TRIANGULO:
-            if (currentForma.verts.size() == 1)
-                bresenhamLine(currentForma.verts[0].x, currentForma.verts[0].y, mouse_x, mouse_y, previewColor);
-            else if (currentForma.verts.size() == 2)
+            for (size_t i = 0; i + 1 < currentForma.verts.size(); ++i)
+                bresenhamLine(currentForma.verts[i].x, currentForma.verts[i].y, currentForma.verts[i + 1].x, currentForma.verts[i + 1].y, previewColor);
+            V2 last = currentForma.verts.back();
+            bresenhamLine(last.x, last.y, mouse_x, mouse_y, previewColor);
+        }
+        break;
+    case M_CIRCULO:
+        if (currentForma.verts.size() >= 1)
+        {
+            int cx = currentForma.verts[0].x, cy = currentForma.verts[0].y;
+            int dx = mouse_x - cx;
+            int dy = mouse_y - cy;
+            int r = (int)round(sqrt(dx * dx + dy * dy));
+            midpointCircle(cx, cy, r, previewColor);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+// Reconstrói a região r do framebuffer: fundo, overlay e as formas cujos spans
+// a intersectam. Os spans em cache são recortados a r, preservando a ordem de
+// pintura das formas que ficam fora da região.
+void recomposeRegion(const Rect &r)
+{
+    clearFramebufferRegion(r);
+    applyOverlayToFramebuffer(r);
+    for (const auto &f : formas)
+    {
+        const SpanCache &c = ensureCached(f);
+        if (rectOverlaps(c.bounds, r))
+            replayCached(c, f.cor, r);
+    }
+}
+
+// Recomposição paralela por blocos. A tela é dividida na grade FB_TILE e as
+// regiões danificadas são cortadas nela. O binning percorre os spans em cache de
+// cada forma e anota, em cada célula tocada, o intervalo de spans da forma que
+// cai naquela faixa de linhas; as formas são divididas em lotes contíguos
+// (um por thread), cada lote com suas próprias listas. Na recomposição cada
+// bloco limpa o fundo, aplica o overlay e reproduz as entradas dos lotes em
+// ordem, recortadas aos seus limites: todo pixel passa pela mesma sequência
+// fundo -> overlay -> formas em ordem de submissão, então o resultado é
+// idêntico ao de recomposeRegion.
+struct TileBinEntry
+{
+    uint32_t shape;       // índice em formas
+    uint32_t first, last; // spans [first,last) da forma na faixa de linhas da célula
+};
+
+struct TileRenderer
+{
+    bool parallel = true;     // false: caminho serial (recomposeRegion)
+    vector<size_t> pending;   // formas com cache inválido neste quadro
+    vector<Rect> tiles;       // pedaços das regiões danificadas
+    vector<int> tileCell;     // célula da grade de cada pedaço
+    vector<char> cellUsed;    // células com algum pedaço
+    int cols = 0, rows = 0;   // dimensões da grade
+    size_t batches = 0;       // lotes de formas do último binning
+    vector<vector<TileBinEntry>> bins; // [lote * células + célula]
+    double lastMs = 0.0;      // tempo da última recomposição
+};
+TileRenderer tileRenderer;
+
+void recomposeRegionsParallel(const vector<Rect> &regions)
+{
+    TileRenderer &tr = tileRenderer;
+
+    // 1) rasteriza em paralelo as formas sem cache (cada uma no seu SpanCache)
+    resolveFormas();
+    tr.pending.clear();
+    for (size_t i = 0; i < formas.size(); ++i)
+        if (!formas[i].cache.valid)
+            tr.pending.push_back(i);
+    parallelFor(tr.pending.size(), [&](size_t k)
+                { rasterizeToCache(formas[tr.pending[k]]); });
+    cacheStats.frameRasterizations += tr.pending.size();
+    cacheStats.totalRasterizations += tr.pending.size();
+    cacheStats.frameHits += formas.size() - tr.pending.size();
+    cacheStats.totalHits += formas.size() - tr.pending.size();
+
+    // 2) corta as regiões na grade (as regiões do DamageTracker são disjuntas)
+    tr.cols = (winW + FB_TILE_MASK) >> FB_TILE_SHIFT;
+    tr.rows = (winH + FB_TILE_MASK) >> FB_TILE_SHIFT;
+    size_t cells = (size_t)tr.cols * tr.rows;
+    tr.cellUsed.assign(cells, 0);
+    tr.tiles.clear();
+    tr.tileCell.clear();
+    for (const Rect &r : regions)
+    {
+        for (int ty = r.y0 & ~FB_TILE_MASK; ty <= r.y1; ty += FB_TILE)
+            for (int tx = r.x0 & ~FB_TILE_MASK; tx <= r.x1; tx += FB_TILE)
             {
-                bresenhamLine(currentForma.verts[0].x, currentForma.verts[0].y, currentForma.verts[1].x, currentForma.verts[1].y, previewColor);
-                bresenhamLine(currentForma.verts[1].x, currentForma.verts[1].y, mouse_x, mouse_y, previewColor);
+                int cell = (ty >> FB_TILE_SHIFT) * tr.cols + (tx >> FB_TILE_SHIFT);
+                tr.tiles.push_back(rectIntersect(r, Rect{tx, ty, tx + FB_TILE_MASK, ty + FB_TILE_MASK}));
+                tr.tileCell.push_back(cell);
+                tr.cellUsed[cell] = 1;
             }
-            break;
-        case M_POLIGONO:
-            if (currentForma.verts.size() >= 1)
+    }
+    if (tr.tiles.empty())
+        return;
+
+    // 3) binning por lotes contíguos de formas; cada lote escreve só nas suas listas
+    tr.batches = max<size_t>(1, min<size_t>(threadPoolSize(), formas.size()));
+    if (tr.bins.size() < tr.batches * cells)
+        tr.bins.resize(tr.batches * cells);
+    parallelFor(tr.batches, [&](size_t b)
+    {
+        vector<TileBinEntry> *bins = &tr.bins[b * cells];
+        for (size_t c = 0; c < cells; ++c)
+            bins[c].clear();
+        size_t i0 = formas.size() * b / tr.batches, i1 = formas.size() * (b + 1) / tr.batches;
+        for (size_t i = i0; i < i1; ++i)
+        {
+            const SpanCache &c = formas[i].cache;
+            bool hit = false;
+            for (const Rect &r : regions)
+                hit = hit || rectOverlaps(c.bounds, r);
+            if (!hit)
+                continue;
+            // spans ordenados por y: cada faixa de FB_TILE linhas é um intervalo contíguo
+            const vector<Span> &sp = c.spans.spans;
+            size_t k = 0;
+            while (k < sp.size())
             {
-                for (size_t i = 0; i + 1 < currentForma.verts.size(); ++i)
-                    bresenhamLine(currentForma.verts[i].x, currentForma.verts[i].y, currentForma.verts[i + 1].x, currentForma.verts[i + 1].y, previewColor);
-                V2 last = currentForma.verts.back();
-                bresenhamLine(last.x, last.y, mouse_x, mouse_y, previewColor);
+                int ty = sp[k].y >> FB_TILE_SHIFT;
+                size_t first = k;
+                int minX = sp[k].x0, maxX = sp[k].x1;
+                for (; k < sp.size() && (sp[k].y >> FB_TILE_SHIFT) == ty; ++k)
+                {
+                    minX = min(minX, sp[k].x0);
+                    maxX = max(maxX, sp[k].x1);
+                }
+                for (int tx = minX >> FB_TILE_SHIFT; tx <= (maxX >> FB_TILE_SHIFT); ++tx)
+                {
+                    int cell = ty * tr.cols + tx;
+                    if (tr.cellUsed[cell])
+                        bins[cell].push_back(TileBinEntry{(uint32_t)i, (uint32_t)first, (uint32_t)k});
+                }
             }
-            break;
-        case M_CIRCULO:
-            if (currentForma.verts.size() >= 1)
+        }
+    });
+
+    // 4) recomposição dos blocos; cada um só escreve dentro dos seus limites
+    parallelFor(tr.tiles.size(), [&](size_t t)
+    {
+        const Rect &tile = tr.tiles[t];
+        clearFramebufferRegion(tile);
+        applyOverlayToFramebuffer(tile);
+        for (size_t b = 0; b < tr.batches; ++b)
+        {
+            for (const TileBinEntry &e : tr.bins[b * cells + tr.tileCell[t]])
             {
-                int cx = currentForma.verts[0].x, cy = currentForma.verts[0].y;
-                int dx = mouse_x - cx;
-                int dy = mouse_y - cy;
-                int r = (int)round(sqrt(dx * dx + dy * dy));
-                midpointCircle(cx, cy, r, previewColor);
+                const Forma &f = formas[e.shape];
+                const Span *sp = f.cache.spans.spans.data();
+                for (uint32_t k = e.first; k < e.last; ++k)
+                {
+                    if (sp[k].y < tile.y0 || sp[k].y > tile.y1)
+                        continue;
+                    int x0 = max(sp[k].x0, tile.x0), x1 = min(sp[k].x1, tile.x1);
+                    if (x0 <= x1)
+                        framebuffer.fillSpan(sp[k].y, x0, x1, f.cor);
+                }
             }
-            break;
-        default:
-            break;
         }
+    });
+}
+
+// Seleção em pontos aleatórios: índice espacial vs busca linear (tempo médio
+// por clique e se as duas escolhem sempre a mesma forma)
+void runPickBenchmark(int n)
+{
+    vector<int> xs(n), ys(n), viaIndex(n), viaScan(n);
+    for (int i = 0; i < n; ++i)
+    {
+        xs[i] = rand() % winW;
+        ys[i] = rand() % winH;
+    }
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; ++i)
+        viaIndex[i] = pickForma(xs[i], ys[i]);
+    auto t1 = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; ++i)
+        viaScan[i] = pickFormaLinear(xs[i], ys[i]);
+    auto t2 = std::chrono::steady_clock::now();
+    double msIndex = std::chrono::duration<double, std::milli>(t1 - t0).count() / n;
+    double msScan = std::chrono::duration<double, std::milli>(t2 - t1).count() / n;
+    printf("Selecao com %zu formas: indice %.4f ms, linear %.4f ms por clique - %s\n",
+           formas.size(), msIndex, msScan, viaIndex == viaScan ? "iguais" : "DIFERENTES");
+}
+
+// Cena de teste com n linhas e n círculos aleatórios: compara a recomposição
+// completa serial e por blocos (tempo e igualdade pixel a pixel) e mede a
+// seleção com picks cliques. A cena fica num vetor à parte; as formas do
+// usuário (com seus caches) voltam intactas no fim.
+void runRedrawBenchmark(int n, int picks)
+{
+    vector<Forma> userFormas;
+    formas.swap(userFormas);
+    for (int i = 0; i < n; ++i)
+    {
+        Forma l;
+        l.tipo = M_LINHA;
+        l.verts = {{rand() % winW, rand() % winH}, {rand() % winW, rand() % winH}};
+        l.cor = fillColors[i % fillColors.size()];
+        formas.push_back(l);
+        Forma c;
+        c.tipo = M_CIRCULO;
+        int cx = rand() % winW, cy = rand() % winH;
+        c.verts = {{cx, cy}, {cx + 5 + rand() % 60, cy}};
+        c.cor = fillColors[(i + 3) % fillColors.size()];
+        formas.push_back(c);
+    }
+    rebuildFormaIndex();
+    Rect all = framebuffer.bounds();
+    vector<Color> serialOut(framebuffer.size()), parallelOut(framebuffer.size());
+    double ms[2];
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        for (auto &f : formas)
+            f.invalidateCache();
+        DamageTracker *saved = damageRecorder;
+        damageRecorder = nullptr;
+        auto t0 = std::chrono::steady_clock::now();
+        if (pass == 0)
+            recomposeRegion(all);
+        else
+            recomposeRegionsParallel(vector<Rect>(1, all));
+        ms[pass] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        damageRecorder = saved;
+        framebuffer.copyToLinear(all, pass == 0 ? serialOut.data() : parallelOut.data(), winW);
+    }
+    bool same = serialOut == parallelOut;
+    printf("Recomposicao de %zu formas: serial %.2f ms, blocos %.2f ms (%u threads, %.1fx) - %s\n",
+           formas.size(), ms[0], ms[1], threadPoolSize(), ms[1] > 0 ? ms[0] / ms[1] : 0.0,
+           same ? "identicas" : "DIFERENTES");
+    runPickBenchmark(picks);
+    formas.swap(userFormas);
+    rebuildFormaIndex();
+    damage.addAll();
+}
+
+// Autoteste (tecla a; não usa a cena do usuário): um retângulo girado 30 graus
+// deve virar 4 vértices na tela, com os 4 cantos desenhados, o meio de cada
+// aresta selecionável e os cantos da caixa alinhada aos eixos (o desenho
+// antigo) fora dele
+void runRotatedRectCheck()
+{
+    Forma f;
+    f.tipo = M_RETANGULO;
+    f.verts = {{100, 100}, {300, 200}};
+    f.xform = aboutPointMat(rotateMat(30), 200, 150);
+    const vector<V2> &P = f.pts();
+    bool ok = P.size() == 4;
+    if (ok)
+    {
+        rasterizeToCache(f);
+        const vector<Span> &sp = f.cache.spans.spans;
+        for (size_t i = 0, j = 3; i < 4; j = i++)
+        {
+            bool corner = false;
+            for (const Span &s : sp)
+                corner = corner || (s.y == P[i].y && P[i].x >= s.x0 && P[i].x <= s.x1);
+            int mx = (P[i].x + P[j].x) / 2, my = (P[i].y + P[j].y) / 2;
+            ok = ok && corner && hitForma(f, mx, my);
+        }
+        Rect b = formaBounds(f);
+        ok = ok && !hitForma(f, b.x0, b.y0) && !hitForma(f, b.x1, b.y0) &&
+             !hitForma(f, b.x1, b.y1) && !hitForma(f, b.x0, b.y1);
     }
+    printf("Retangulo girado: %zu vertices - %s\n", P.size(), ok ? "4 arestas ok" : "FALHOU");
+}
+
+// Refaz a camada de preview a partir da forma em construção e do cursor; sem
+// forma em construção, mostra o contorno da forma selecionada
+void rebuildPreviewLayer()
+{
+    previewLayer.spans.clear();
+    if (!drawing && selectedForma < 0)
+        return;
+    DamageTracker *saved = damageRecorder;
+    damageRecorder = nullptr; // o preview não toca a imagem base
+    pixelCapture = &previewLayer.spans;
+    if (drawing)
+        drawPreview();
+    else
+        drawForma(formas[selectedForma]);
+    pixelCapture = nullptr;
+    damageRecorder = saved;
+}
+
+void redrawAll()
+{
+    cacheStats.frameHits = 0;
+    cacheStats.frameRasterizations = 0;
+
+    // Recompõe na imagem base apenas as regiões danificadas; as escritas não geram novo dano
+    auto t0 = std::chrono::steady_clock::now();
+    damageRecorder = nullptr;
+    if (tileRenderer.parallel)
+        recomposeRegionsParallel(damage.rects());
+    else
+        for (const Rect &r : damage.rects())
+            recomposeRegion(r);
+    damageRecorder = &damage;
+    if (!damage.empty())
+        tileRenderer.lastMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+    // Regiões da base a reenviar
+    static vector<Rect> dirty;
+    dirty = damage.rects();
+    damage.clear();
+
+    // Preview em camada separada: independe do número de formas confirmadas
+    rebuildPreviewLayer();
 
     // --- MENU SUPERIOR DE CORES ---
     auto drawTopColorMenu = [&]() {
@@ -737,7 +1702,7 @@ void redrawAll()
             int y0 = ytop + (menuH - colorBoxH) / 2;
             Color c = fillColors[i];
             // destaque se selecionada
-            if (colorEqual(c, currentFillColor)) {
+            if (c == currentFillColor) {
                 glColor3ub(50, 50, 50);
                 glLineWidth(3.0f);
                 glBegin(GL_LINE_LOOP);
@@ -761,7 +1726,9 @@ void redrawAll()
         }
     };
 
-    flushFramebuffer();
+    flushFramebuffer(dirty);
+    const Color &pc = previewLayer.color;
+    presentOverlaySpans(previewLayer.spans.spans.data(), previewLayer.spans.size(), pc.r, pc.g, pc.b);
 
     // draw sidebar BEFORE overlays and UI text
     auto drawSidebar = [&]() {
@@ -968,7 +1935,25 @@ void redrawAll()
                                                                        : modo == M_POLIGONO    ? "Poligono"
                                                                                                : "Circulo"),
                      0.15);
-    draw_text_stroke(sidebarWidth + 5, 5, string("Atalhos: l=linha r=ret t=tri p=pol c=circ f=scanfill o=flood x=clear esc=sair"), 0.12);
+    draw_text_stroke(sidebarWidth + 5, 5, string("Atalhos: l=linha r=ret t=tri p=pol c=circ f=preencher o=flood x=clear v=present g=layout m=threads k=cena b=bench a=autoteste s=selecionar setas=mover q/e=girar +/-=escala h=espelhar esc=sair"), 0.12);
+
+    // Tempo de envio do framebuffer no último quadro (backend de apresentação)
+    const PresentStats &ps = getPresentStats();
+    char presentInfo[96];
+    snprintf(presentInfo, sizeof(presentInfo), "Present: %s %.2f ms (media %.2f ms)",
+             presentModeName(getPresentMode()), ps.lastMs, ps.avgMs);
+    draw_text_stroke(sidebarWidth + 5, 60, string(presentInfo), 0.10);
+    char cacheInfo[128];
+    snprintf(cacheInfo, sizeof(cacheInfo), "Cache spans: %lu hits, %lu rasterizacoes (total %lu / %lu)",
+             cacheStats.frameHits, cacheStats.frameRasterizations, cacheStats.totalHits, cacheStats.totalRasterizations);
+    draw_text_stroke(sidebarWidth + 5, 75, string(cacheInfo), 0.10);
+    char redrawInfo[96];
+    snprintf(redrawInfo, sizeof(redrawInfo), "Recomposicao: %s %.2f ms (%u threads)",
+             tileRenderer.parallel ? "blocos" : "serial", tileRenderer.lastMs,
+             tileRenderer.parallel ? threadPoolSize() : 1u);
+    draw_text_stroke(sidebarWidth + 5, 90, string(redrawInfo), 0.10);
+    if (fillInfo[0])
+        draw_text_stroke(sidebarWidth + 5, 105, string(fillInfo), 0.10);
 
     glutSwapBuffers();
 }
@@ -993,9 +1978,51 @@ void reshape(int w, int h)
     glLoadIdentity();
 
     // Rebuild framebuffer
-    framebuffer.assign(winW * winH, WHITE);
-    overlayBuffer.assign(winW * winH, WHITE);
-    overlayMask.assign(winW * winH, 0);
+    framebuffer.resize(winW, winH, WHITE);
+    overlayBuffer.resize(winW, winH, OVERLAY_EMPTY);
+    damage.setBounds(winW, winH);
+    damage.addAll();
+    // os caches estão recortados à janela antiga
+    for (auto &f : formas)
+        f.invalidateCache();
+    rebuildFormaIndex();
+}
+
+// Setas: deslocam a cena inteira (todas as formas) em 10 pixels, exercitando a
+// transformação em lote de todas as formas (transformAllFormas)
+void specialKeys(int key, int x, int y)
+{
+    (void)x; // posição do mouse: não usada
+    (void)y;
+    int dx = 0, dy = 0;
+    switch (key)
+    {
+    case GLUT_KEY_LEFT:
+        dx = -10;
+        break;
+    case GLUT_KEY_RIGHT:
+        dx = 10;
+        break;
+    case GLUT_KEY_UP:
+        dy = 10;
+        break;
+    case GLUT_KEY_DOWN:
+        dy = -10;
+        break;
+    default:
+        return;
+    }
+    transformAllFormas(translateMat(dx, dy));
+    glutPostRedisplay();
+}
+
+// Transforma a forma selecionada (ou a última confirmada) em torno do seu centro
+void transformSelectedForma(const Mat3 &M)
+{
+    if (formas.empty())
+        return;
+    transformForma(selectedForma >= 0 ? formas[selectedForma] : formas.back(), M);
+    glutPostRedisplay();
 }
 
 void keyboard(unsigned char key, int x, int y)
@@ -1009,6 +2036,7 @@ void keyboard(unsigned char key, int x, int y)
     case '1':
         modo = M_LINHA;
         floodMode = false;
+        selectMode = false;
         drawing = false;
         cout << "Modo: Linha\n";
         break;
@@ -1016,6 +2044,7 @@ void keyboard(unsigned char key, int x, int y)
     case '2':
         modo = M_RETANGULO;
         floodMode = false;
+        selectMode = false;
         drawing = false;
         cout << "Modo: Retangulo\n";
         break;
@@ -1023,6 +2052,7 @@ void keyboard(unsigned char key, int x, int y)
     case '3':
         modo = M_TRIANGULO;
         floodMode = false;
+        selectMode = false;
         drawing = false;
         cout << "Modo: Triangulo\n";
         break;
@@ -1030,6 +2060,7 @@ void keyboard(unsigned char key, int x, int y)
     case '4':
         modo = M_POLIGONO;
         floodMode = false;
+        selectMode = false;
         drawing = false;
         cout << "Modo: Poligono\n";
         break;
@@ -1037,32 +2068,107 @@ void keyboard(unsigned char key, int x, int y)
     case '5':
         modo = M_CIRCULO;
         floodMode = false;
+        selectMode = false;
         drawing = false;
         cout << "Modo: Circulo\n";
         break;
     case 'x': // clear
-        formas.clear();
+        clearFormas();
         clearScreen();
         break;
-    case 'f': // scanline fill last polygon-like shape
+    case 'v': // alterna backend de apresentação (textura -> glDrawPixels -> GL_POINTS)
+    {
+        PresentMode next = PresentMode((getPresentMode() + 1) % PRESENT_MODE_COUNT);
+        setPresentMode(next);
+        cout << "Apresentacao: " << presentModeName(getPresentMode()) << "\n";
+        break;
+    }
+    case 'b': // microbenchmarks no console
+        cout << "Kernel de spans em uso: " << spanKernelISAName(getSpanKernelISA()) << "\n";
+        runSpanBenchmark();
+        runLayoutBenchmark();
+        runTransformBenchmark();
+        runClipBenchmark();
+        runLineBenchmark();
+        runCircleBenchmark();
+        break;
+    case 'm': // recomposição por blocos e scanline fill em paralelo <-> serial
+        tileRenderer.parallel = !tileRenderer.parallel;
+        fillCtx.parallel = tileRenderer.parallel;
+        damage.addAll();
+        cout << "Recomposicao e scanline fill: " << (tileRenderer.parallel ? "paralelos" : "seriais") << "\n";
+        break;
+    case 'k': // cena de teste com muitas formas: serial vs paralelo, seleção
+        runRedrawBenchmark(10000, 1000);
+        break;
+    case 'a': // autoteste: retângulo girado mantém as 4 arestas (desenho e seleção)
+        runRotatedRectCheck();
+        break;
+    case 's': // modo seleção: clique escolhe a forma sob o cursor
+        selectMode = true;
+        floodMode = false;
+        drawing = false;
+        cout << "Modo Selecao: clique numa forma (q/e/+/-/h transformam a selecionada)\n";
+        break;
+    case 'g': // alterna o layout do framebuffer (linear <-> blocos 64x64)
+    {
+        FramebufferLayout next = FramebufferLayout((framebuffer.layout() + 1) % FB_LAYOUT_COUNT);
+        framebuffer.setLayout(next);
+        overlayBuffer.setLayout(next);
+        damage.addAll(); // a cópia linear da apresentação é refeita
+        cout << "Layout do framebuffer: " << (next == FB_LAYOUT_TILED ? "blocos 64x64" : "linear") << "\n";
+        break;
+    }
+    case 'f': // scanline fill last polygon-like shape (ou disco do último círculo)
         if (!formas.empty())
         {
             Forma &last = formas.back();
-            if (last.tipo == M_POLIGONO && last.verts.size() >= 3)
+            if (last.tipo == M_CIRCULO && last.verts.size() >= 2)
+            {
+                redrawAll();
+                const vector<V2> &P = last.pts();
+                int dx = P[1].x - P[0].x, dy = P[1].y - P[0].y;
+                int r = (int)round(sqrt(dx * dx + dy * dy));
+                auto t0 = std::chrono::steady_clock::now();
+                fillCircleMidpoint(P[0].x, P[0].y, r, currentFillColor);
+                double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+                snprintf(fillInfo, sizeof(fillInfo), "Disco (raio %d): %.2f ms", r, ms);
+                glutPostRedisplay();
+            }
+            else if (last.tipo == M_POLIGONO && last.verts.size() >= 3)
             {
                 redrawAll(); // redesenha todas as formas no framebuffer antes de preencher
-                fillPolygonScanline(last.verts, currentFillColor);
+                fillPolygonScanline(last.pts(), currentFillColor);
+                snprintf(fillInfo, sizeof(fillInfo), "Scanline fill: %.2f ms, %lu alocacoes (total %lu em %lu chamadas)",
+                         fillCtx.lastMs, fillCtx.lastAllocations, fillCtx.totalAllocations, fillCtx.calls);
                 glutPostRedisplay();
             }
             else
             {
-                cout << "Ultima forma nao e poligono com 3+ vertices\n";
+                cout << "Ultima forma nao e poligono com 3+ vertices nem circulo\n";
             }
         }
         break;
+    case 'q': // gira a forma selecionada (ou a última) 15 graus (anti-horário)
+        transformSelectedForma(rotateMat(15));
+        break;
+    case 'e': // gira a forma selecionada (ou a última) 15 graus (horário)
+        transformSelectedForma(rotateMat(-15));
+        break;
+    case '+': // aumenta a forma selecionada (ou a última)
+    case '=':
+        transformSelectedForma(scaleMat(1.1, 1.1));
+        break;
+    case '-': // diminui a forma selecionada (ou a última)
+        transformSelectedForma(scaleMat(1 / 1.1, 1 / 1.1));
+        break;
+    case 'h': // espelha a forma selecionada (ou a última) na horizontal
+        transformSelectedForma(reflectMat(true, false));
+        break;
     case 'o': // enable flood fill mode - user should click to fill
         cout << "Modo Flood-Fill: clique na regiao para preencher\n";
         floodMode = true;
+        selectMode = false;
         drawing = false; // ensure we don't keep collecting vertices while in flood mode
         // currentFillColor permanece o mesmo até o usuário clicar no menu de cor
         break;
@@ -1071,7 +2177,7 @@ void keyboard(unsigned char key, int x, int y)
         {
             if (currentForma.verts.size() >= 3)
             {
-                formas.push_back(currentForma);
+                addForma(currentForma);
                 drawing = false;
                 redrawAll();
             }
@@ -1142,6 +2248,7 @@ void mouse(int button, int state, int x, int y)
                             if (i == 3) newMode = M_POLIGONO;
                             if (i == 4) newMode = M_CIRCULO;
                             modo = newMode;
+                            selectMode = false;
                             drawing = false; // cancel any current drawing
                             cout << "Modo selecionado: " << labels[i] << "\n";
                         }
@@ -1157,8 +2264,8 @@ void mouse(int button, int state, int x, int y)
                         else if (i == 6)
                         {
                             // clear
-                            formas.clear();
-                            std::fill(framebuffer.begin(), framebuffer.end(), WHITE);
+                            clearFormas();
+                            framebuffer.clear(WHITE);
                             glClear(GL_COLOR_BUFFER_BIT);
                             glutSwapBuffers();
                             clearScreen();
@@ -1185,6 +2292,20 @@ void mouse(int button, int state, int x, int y)
             return;
         }
 
+        // Modo seleção: escolhe (ou desfaz a seleção) sem coletar vértices
+        if (selectMode)
+        {
+            auto t0 = std::chrono::steady_clock::now();
+            selectedForma = pickForma(x, yy);
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+            if (selectedForma >= 0)
+                cout << "Selecionada forma " << selectedForma << " (" << ms << " ms)\n";
+            else
+                cout << "Nenhuma forma sob o cursor\n";
+            glutPostRedisplay();
+            return;
+        }
+
         // dependendo do modo, coletar pontos
         if (modo == M_LINHA)
         {
@@ -1200,7 +2321,7 @@ void mouse(int button, int state, int x, int y)
             else
             {
                 currentForma.verts.push_back({x, yy});
-                formas.push_back(currentForma);
+                addForma(currentForma);
                 drawing = false;
                 redrawAll();
             }
@@ -1219,7 +2340,7 @@ void mouse(int button, int state, int x, int y)
             else
             {
                 currentForma.verts.push_back({x, yy});
-                formas.push_back(currentForma);
+                addForma(currentForma);
                 drawing = false;
                 redrawAll();
             }
@@ -1240,9 +2361,9 @@ void mouse(int button, int state, int x, int y)
                 currentForma.verts.push_back({x, yy});
                 if (currentForma.verts.size() == 3)
                 {
-                    formas.push_back(currentForma);
-                    std::fill(overlayBuffer.begin(), overlayBuffer.end(), WHITE);
-                    std::fill(overlayMask.begin(), overlayMask.end(), 0);
+                    addForma(currentForma);
+                    overlayBuffer.clear(OVERLAY_EMPTY);
+                    damage.addAll(); // overlay inteiro descartado
                     drawing = false;
                     redrawAll();
                 }
@@ -1280,7 +2401,7 @@ void mouse(int button, int state, int x, int y)
             else
             {
                 currentForma.verts.push_back({x, yy}); // ponto para definir raio
-                formas.push_back(currentForma);
+                addForma(currentForma);
                 drawing = false;
                 redrawAll();
             }
@@ -1339,15 +2460,19 @@ int main(int argc, char **argv)
     glutCreateWindow("PaintCG - Bresenham e Rasterizacao");
 
     // init framebuffer
-    framebuffer.assign(winW * winH, WHITE);
-    overlayBuffer.assign(winW * winH, WHITE);
-    overlayMask.assign(winW * winH, 0);
+    framebuffer.resize(winW, winH, WHITE);
+    overlayBuffer.resize(winW, winH, OVERLAY_EMPTY);
+    damage.setBounds(winW, winH);
+    damage.addAll();
+    formaIndex.reset(winW, winH);
     glClearColor(1, 1, 1, 1);
     glPointSize(1.0f);
+    presentInit();
 
     glutReshapeFunc(reshape);
     glutDisplayFunc(display);
     glutKeyboardFunc(keyboard);
+    glutSpecialFunc(specialKeys);
     glutMouseFunc(mouse);
     glutPassiveMotionFunc(motionPassive);
 
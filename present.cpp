@@ -0,0 +1,207 @@
+#include "present.h"
+#include <GL/glut.h>
+#include <chrono>
+#include <cstdio>
+
+static PresentMode g_mode = PRESENT_TEXTURE;
+static PresentStats g_stats;
+
+// textura de streaming (dimensões em potência de 2 para funcionar até em GL 1.1)
+static GLuint g_tex = 0;
+static int g_texW = 0, g_texH = 0;
+static bool g_texFailed = false;
+static bool g_texValid = false; // conteúdo da textura corresponde ao framebuffer
+
+static int nextPow2(int v){
+    int p = 1;
+    while(p < v) p <<= 1;
+    return p;
+}
+
+void presentInit(){
+    g_tex = 0; g_texW = g_texH = 0; g_texFailed = false;
+    glGenTextures(1, &g_tex);
+    if(glGetError() != GL_NO_ERROR || g_tex == 0){
+        g_texFailed = true;
+        g_mode = PRESENT_DRAWPIXELS;
+    }
+}
+
+void setPresentMode(PresentMode m){
+    if(m == PRESENT_TEXTURE && g_texFailed) m = PRESENT_DRAWPIXELS;
+    g_mode = m;
+    g_texValid = false; // a textura não acompanhou os outros backends
+    g_stats = PresentStats();
+}
+
+PresentMode getPresentMode(){ return g_mode; }
+
+const char* presentModeName(PresentMode m){
+    switch(m){
+    case PRESENT_TEXTURE: return "Textura";
+    case PRESENT_DRAWPIXELS: return "DrawPixels";
+    case PRESENT_POINTS: return "GL_POINTS";
+    default: return "?";
+    }
+}
+
+const PresentStats& getPresentStats(){ return g_stats; }
+
+// garante textura com pelo menos w x h texels; retorna false se o driver recusar
+static bool ensureTexture(int w, int h){
+    int tw = nextPow2(w), th = nextPow2(h);
+    glBindTexture(GL_TEXTURE_2D, g_tex);
+    if(tw == g_texW && th == g_texH) return true;
+    g_texValid = false;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, tw, th, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    if(glGetError() != GL_NO_ERROR){
+        g_texW = g_texH = 0;
+        return false;
+    }
+    g_texW = tw; g_texH = th;
+    return true;
+}
+
+// envia só as regiões alteradas; a textura guarda o restante do quadro anterior
+static long long uploadTexture(const Color* px, int w, int h, const std::vector<Rect>* dirty){
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    if(!dirty || !g_texValid){
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, px);
+        g_texValid = true;
+        return (long long)w * h;
+    }
+    long long sent = 0;
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, w);
+    for(const Rect &d: *dirty){
+        Rect r = rectIntersect(d, Rect{0, 0, w - 1, h - 1});
+        if(r.empty()) continue;
+        glPixelStorei(GL_UNPACK_SKIP_PIXELS, r.x0);
+        glPixelStorei(GL_UNPACK_SKIP_ROWS, r.y0);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, r.x0, r.y0, r.x1 - r.x0 + 1, r.y1 - r.y0 + 1,
+                        GL_RGBA, GL_UNSIGNED_BYTE, px);
+        sent += r.area();
+    }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+    return sent;
+}
+
+static void drawTextureQuad(int w, int h){
+    float s = (float)w / g_texW;
+    float t = (float)h / g_texH;
+    glEnable(GL_TEXTURE_2D);
+    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+    glBegin(GL_QUADS);
+    glTexCoord2f(0, 0); glVertex2i(0, 0);
+    glTexCoord2f(s, 0); glVertex2i(w, 0);
+    glTexCoord2f(s, t); glVertex2i(w, h);
+    glTexCoord2f(0, t); glVertex2i(0, h);
+    glEnd();
+    glDisable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+static void presentDrawPixels(const Color* px, int w, int h){
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glRasterPos2i(0, 0);
+    glDrawPixels(w, h, GL_RGBA, GL_UNSIGNED_BYTE, px);
+}
+
+// caminho original: um vértice por pixel
+static void presentPoints(const Color* px, int w, int h){
+    glBegin(GL_POINTS);
+    for(int y = 0; y < h; ++y){
+        const Color* row = px + (size_t)y * w;
+        for(int x = 0; x < w; ++x){
+            glColor3ub(row[x].r, row[x].g, row[x].b);
+            glVertex2i(x, y);
+        }
+    }
+    glEnd();
+}
+
+// Cópia linear de um framebuffer em blocos, mantida entre quadros: só as
+// regiões alteradas são convertidas (a cópia acompanha a imagem como a textura)
+static std::vector<Color> g_staging;
+static const Framebuffer* g_stagingSrc = nullptr;
+static int g_stagingW = 0, g_stagingH = 0;
+
+static const Color* linearPixels(const Framebuffer& fb, const std::vector<Rect>* dirty){
+    const int w = fb.width(), h = fb.height();
+    if(fb.linear()){
+        g_stagingSrc = nullptr; // a cópia deixa de acompanhar a imagem
+        return fb.data();
+    }
+    bool valid = g_stagingSrc == &fb && g_stagingW == w && g_stagingH == h;
+    g_staging.resize(fb.size());
+    if(dirty && valid){
+        for(const Rect &d: *dirty) fb.copyToLinear(d, g_staging.data(), w);
+    } else {
+        fb.copyToLinear(fb.bounds(), g_staging.data(), w);
+    }
+    g_stagingSrc = &fb; g_stagingW = w; g_stagingH = h;
+    return g_staging.data();
+}
+
+static void presentFrameImpl(const Framebuffer& fb, const std::vector<Rect>* dirty){
+    if(fb.empty()) return;
+    const int w = fb.width(), h = fb.height();
+    auto t0 = std::chrono::steady_clock::now();
+    const Color* px = linearPixels(fb, dirty);
+
+    if(g_mode == PRESENT_TEXTURE && !ensureTexture(w, h)){
+        // driver recusou a textura (tamanho máximo, falta de memória...): cai para o blit
+        std::fprintf(stderr, "present: textura %dx%d indisponivel, usando glDrawPixels\n", w, h);
+        g_texFailed = true;
+        g_mode = PRESENT_DRAWPIXELS;
+    }
+    long long sent = (long long)w * h;
+    switch(g_mode){
+    case PRESENT_TEXTURE:
+        sent = uploadTexture(px, w, h, dirty);
+        drawTextureQuad(w, h);
+        break;
+    case PRESENT_DRAWPIXELS: presentDrawPixels(px, w, h); break;
+    default: presentPoints(px, w, h); break;
+    }
+    // espera o driver consumir o envio para que o tempo medido seja o custo real
+    // (em GL por software, como o Mesa llvmpipe, é onde a diferença aparece)
+    glFinish();
+
+    auto t1 = std::chrono::steady_clock::now();
+    double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+    g_stats.lastMs = ms;
+    g_stats.avgMs = g_stats.frames == 0 ? ms : g_stats.avgMs * 0.9 + ms * 0.1;
+    g_stats.lastPixels = sent;
+    ++g_stats.frames;
+}
+
+void presentFrame(const Framebuffer& fb){
+    presentFrameImpl(fb, nullptr);
+}
+
+void presentFrame(const Framebuffer& fb, const std::vector<Rect>& dirty){
+    presentFrameImpl(fb, &dirty);
+}
+
+void presentOverlaySpans(const Span* spans, size_t n, unsigned char r, unsigned char g, unsigned char b){
+    if(n == 0) return;
+    glColor3ub(r, g, b);
+    // um quad por span (como submitSpansGL): o custo cresce com o número de
+    // spans, não com o de pixels do contorno
+    glBegin(GL_QUADS);
+    for(size_t i = 0; i < n; ++i){
+        // o quad [x0, x1+1] x [y, y+1] cobre exatamente os pixels do span
+        const Span &s = spans[i];
+        glVertex2i(s.x0, s.y);
+        glVertex2i(s.x1 + 1, s.y);
+        glVertex2i(s.x1 + 1, s.y + 1);
+        glVertex2i(s.x0, s.y + 1);
+    }
+    glEnd();
+}
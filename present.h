@@ -0,0 +1,48 @@
+#pragma once
+#include "damage.h"
+#include "span.h"
+#include "framebuffer.h"
+#include <vector>
+#include <cstddef>
+
+// Apresentação do framebuffer em RAM na janela.
+// Em vez de enviar um vértice GL_POINTS por pixel, a imagem inteira é enviada
+// de uma vez (textura atualizada por glTexSubImage2D ou um único glDrawPixels).
+// O caminho antigo por pontos continua disponível como fallback.
+
+enum PresentMode {
+    PRESENT_TEXTURE = 0, // textura "streamed" + um quad texturizado
+    PRESENT_DRAWPIXELS,  // um único blit via glDrawPixels
+    PRESENT_POINTS,      // fallback: um glVertex2i por pixel dentro de GL_POINTS
+    PRESENT_MODE_COUNT
+};
+
+struct PresentStats {
+    double lastMs = 0.0;   // tempo de envio do último quadro (ms)
+    double avgMs = 0.0;    // média móvel exponencial
+    unsigned long frames = 0;
+    long long lastPixels = 0; // pixels efetivamente enviados no último quadro
+};
+
+// deve ser chamada com um contexto GL ativo (depois de glutCreateWindow)
+void presentInit();
+
+void setPresentMode(PresentMode m);
+PresentMode getPresentMode();
+const char* presentModeName(PresentMode m);
+
+// envia a imagem RGBA do framebuffer (linha 0 = base da janela) cobrindo a janela
+// inteira; no layout linear a memória de fb vai ao GL sem conversão, no layout em
+// blocos passa antes por uma cópia linear (refeita só nas regiões alteradas)
+void presentFrame(const Framebuffer& fb);
+
+// idem, mas só as regiões em "dirty" mudaram desde o último quadro. No backend de
+// textura apenas essas regiões são reenviadas; os demais redesenham tudo (o back
+// buffer não é preservado entre quadros).
+void presentFrame(const Framebuffer& fb, const std::vector<Rect>& dirty);
+
+// desenha por cima da imagem já apresentada uma camada pequena de spans de uma
+// cor, sem tocar na imagem base nem na textura
+void presentOverlaySpans(const Span* spans, size_t n, unsigned char r, unsigned char g, unsigned char b);
+
+const PresentStats& getPresentStats();
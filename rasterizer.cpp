@@ -1,24 +1,61 @@
 #include "rasterizer.h"
+#include "clipping.h"
 #include <cmath>
 #include <GL/glut.h>
 #include <algorithm>
 #include <cassert>
+#include <limits>
 
-static Color *g_frame = nullptr;
-static int g_w = 0, g_h = 0;
+// framebuffer registrado; setFrameBufferPointer usa g_external como vista da memória de terceiros
+static Framebuffer g_external;
+static Framebuffer *g_fb = nullptr;
+
+void setFrameBuffer(Framebuffer* fb){
+    g_fb = (fb && !fb->empty()) ? fb : nullptr;
+}
+
+Framebuffer* getFrameBuffer(){ return g_fb; }
 
 void setFrameBufferPointer(Color* ptr, int w, int h){
-    g_frame = ptr; g_w = w; g_h = h;
+    g_external.attach(ptr, w, h);
+    setFrameBuffer(&g_external);
 }
 
-static inline bool inside(int x,int y){
-    return x>=0 && y>=0 && x<g_w && y<g_h;
+Color* getFrameBufferPointer(int &w, int &h){
+    w = g_fb ? g_fb->width() : 0;
+    h = g_fb ? g_fb->height() : 0;
+    return g_fb ? g_fb->data() : nullptr;
+}
+
+void uploadFrameBufferRegion(int x0, int y0, int x1, int y1){
+    if(!g_fb) return;
+    Rect r = rectIntersect(Rect{x0, y0, x1, y1}, g_fb->bounds());
+    if(r.empty()) return;
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glRasterPos2i(r.x0, r.y0);
+    if(!g_fb->linear()){
+        // layout em blocos: só o retângulo é convertido para linear
+        static std::vector<Color> staging;
+        int rw = r.x1 - r.x0 + 1, rh = r.y1 - r.y0 + 1;
+        staging.resize((size_t)rw * rh);
+        g_fb->copyToLinear(r, staging.data(), rw, r.x0, r.y0);
+        glDrawPixels(rw, rh, GL_RGBA, GL_UNSIGNED_BYTE, staging.data());
+        return;
+    }
+    // linhas do framebuffer têm width() pixels; só o retângulo pedido é lido
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, g_fb->width());
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, r.x0);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, r.y0);
+    glDrawPixels(r.x1 - r.x0 + 1, r.y1 - r.y0 + 1, GL_RGBA, GL_UNSIGNED_BYTE, g_fb->data());
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
 }
 
 void putPixelToBuffer(int x,int y,const Color &c){
-    if(!g_frame) return;
-    if(!inside(x,y)) return;
-    g_frame[y * g_w + x] = c;
+    if(!g_fb) return;
+    if(!g_fb->inside(x,y)) return;
+    g_fb->at(x,y) = c;
 }
 
 void putPixelGL(int x,int y,const Color &c){
@@ -36,57 +73,157 @@ void putPixel(int x, int y, const Color &c, bool glDraw){
     }
 }
 
-// drawLineBresenham com técnica de redução (steep, swap endpoints)
-void drawLineBresenham(int x0, int y0, int x1, int y1, const Color &c){
-    bool steep = std::abs(y1 - y0) > std::abs(x1 - x0);
-    if(steep){
-        std::swap(x0,y0);
-        std::swap(x1,y1);
-    }
-    if(x0 > x1){
-        std::swap(x0,x1);
-        std::swap(y0,y1);
+void drawHLine(int y, int x0, int x1, const Color &c){
+    if(g_fb) g_fb->fillSpan(y, x0, x1, c);
+}
+
+void submitSpansGL(const std::vector<Span>& spans, const Color &c){
+    if(spans.empty()) return;
+    glColor4ub(c.r,c.g,c.b,c.a);
+    glBegin(GL_QUADS);
+    for(const Span &s: spans){
+        // o quad [x0, x1+1] x [y, y+1] cobre exatamente os pixels do span
+        glVertex2i(s.x0, s.y);
+        glVertex2i(s.x1 + 1, s.y);
+        glVertex2i(s.x1 + 1, s.y + 1);
+        glVertex2i(s.x0, s.y + 1);
     }
-    int dx = x1 - x0;
-    int dy = std::abs(y1 - y0);
-    int error = dx / 2;
-    int ystep = (y0 < y1) ? 1 : -1;
-    int y = y0;
-    for(int x = x0; x <= x1; ++x){
-        if(steep)
-            putPixel(y, x, c, true); // inversão de coordenadas
-        else
-            putPixel(x, y, c, true);
-        error -= dy;
-        if(error < 0){
-            y += ystep;
-            error += dx;
+    glEnd();
+}
+
+// drawLineBresenham com técnica de redução (steep, swap endpoints). Com um
+// framebuffer registrado a linha é recortada a ele antes do laço (clipBresenham)
+// e os pixels visíveis são escritos sem teste de limites; sem framebuffer, só a
+// GL os recebe. Os pixels saem em trechos (rasterizeBresenham): horizontais
+// (fillSpan) nas linhas abertas e verticais (fillColumn) nas íngremes, cada um
+// enviado à GL como um quad que cobre exatamente seus pixels, num único
+// glBegin(GL_QUADS).
+void drawLineBresenham(int x0, int y0, int x1, int y1, const Color &c){
+    BresenhamClip lc;
+    const int big = std::numeric_limits<int>::max() / 4;
+    Rect clip = g_fb ? g_fb->bounds() : Rect{-big, -big, big, big};
+    if(!clipBresenham(x0, y0, x1, y1, clip.x0, clip.y0, clip.x1, clip.y1, lc)) return;
+    glColor4ub(c.r,c.g,c.b,c.a);
+    glBegin(GL_QUADS);
+    auto run = [&](int y, int xa, int xb){
+        // trecho na tela: [qx0,qx1] x [qy0,qy1] (inversão de coordenadas se steep)
+        int qx0 = lc.steep ? y : xa, qx1 = lc.steep ? y : xb;
+        int qy0 = lc.steep ? xa : y, qy1 = lc.steep ? xb : y;
+        if(g_fb){
+            if(lc.steep) g_fb->fillColumn(qx0, qy0, qy1, c);
+            else g_fb->fillSpan(qy0, qx0, qx1, c);
         }
-    }
+        glVertex2i(qx0, qy0);
+        glVertex2i(qx1 + 1, qy0);
+        glVertex2i(qx1 + 1, qy1 + 1);
+        glVertex2i(qx0, qy1 + 1);
+    };
+    rasterizeBresenham(lc, run, [&](int y, int x){ run(y, x, x); });
+    glEnd();
 }
 
 // midpoint circle (Bresenham-like)
-void drawCircleBresenham(int xc, int yc, int r, const Color &c){
-    int x = 0, y = r;
+// Os passos (x, y) do octante de 0 a 45 graus são agrupados pelo y: cada grupo
+// x em [xa,xb] dá, pela simetria de 8, 4 trechos horizontais (linhas yc +- y) e
+// 4 verticais (colunas xc +- y), fn(x0, y0, x1, y1) inclusivos, com os mesmos
+// pixels de plotar os 8 pontos de cada passo.
+template <typename F>
+static void circleRuns(int xc, int yc, int r, F fn){
+    auto level = [&](int xa, int xb, int y){
+        fn(xc + xa, yc + y, xc + xb, yc + y);
+        fn(xc - xb, yc + y, xc - xa, yc + y);
+        fn(xc + xa, yc - y, xc + xb, yc - y);
+        fn(xc - xb, yc - y, xc - xa, yc - y);
+        fn(xc + y, yc + xa, xc + y, yc + xb);
+        fn(xc - y, yc + xa, xc - y, yc + xb);
+        fn(xc + y, yc - xb, xc + y, yc - xa);
+        fn(xc - y, yc - xb, xc - y, yc - xa);
+    };
+    int x = 0, y = r, xa = 0;
     int d = 3 - 2 * r;
-    auto plot8 = [&](int xx, int yy){
-        putPixel(xc + xx, yc + yy, c, true);
-        putPixel(xc - xx, yc + yy, c, true);
-        putPixel(xc + xx, yc - yy, c, true);
-        putPixel(xc - xx, yc - yy, c, true);
-        putPixel(xc + yy, yc + xx, c, true);
-        putPixel(xc - yy, yc + xx, c, true);
-        putPixel(xc + yy, yc - xx, c, true);
-        putPixel(xc - yy, yc - xx, c, true);
+    while(y >= x){
+        ++x;
+        if(d > 0){
+            level(xa, x - 1, y); // y vai mudar
+            xa = x;
+            --y;
+            d = d + 4 * (x - y) + 10;
+        } else {
+            d = d + 4 * x + 6;
+        }
+    }
+    if(xa <= x - 1) level(xa, x - 1, y);
+}
+
+// Disco com as mesmas decisões: cada passo (x, y) dá as linhas yc +- x com
+// [xc-y, xc+y], e o fim de cada grupo de y dá as linhas yc +- y com o maior x do
+// grupo. Como aqui x nunca passa de y, as duas famílias de linhas não se
+// repetem: fn(y, x0, x1) uma vez por linha do disco.
+template <typename F>
+static void discSpans(int xc, int yc, int r, F fn){
+    auto rows = [&](int k, int half){
+        fn(yc + k, xc - half, xc + half);
+        if(k != 0) fn(yc - k, xc - half, xc + half);
     };
+    int x = 0, y = r;
+    int d = 3 - 2 * r;
     while(y >= x){
-        plot8(x,y);
+        rows(x, y);
         ++x;
         if(d > 0){
+            if(y > x - 1) rows(y, x - 1);
             --y;
             d = d + 4 * (x - y) + 10;
         } else {
             d = d + 4 * x + 6;
         }
     }
-}
\ No newline at end of file
+}
+
+Rect circleToBuffer(Framebuffer& fb, int xc, int yc, int r, const Color &c){
+    if(r < 0) return emptyRect();
+    circleRuns(xc, yc, r, [&](int x0, int y0, int x1, int y1){
+        if(x0 == x1 && y0 == y1){
+            // perto da diagonal os trechos têm 1 pixel: direto, sem chamada
+            if(fb.inside(x0, y0)) fb.at(x0, y0) = c;
+        }
+        else if(y0 == y1) fb.fillSpan(y0, x0, x1, c);
+        else fb.fillColumn(x0, y0, y1, c);
+    });
+    return rectIntersect(Rect{xc - r, yc - r, xc + r, yc + r}, fb.bounds());
+}
+
+Rect discToBuffer(Framebuffer& fb, int xc, int yc, int r, const Color &c){
+    if(r < 0) return emptyRect();
+    discSpans(xc, yc, r, [&](int y, int x0, int x1){ fb.fillSpan(y, x0, x1, c); });
+    return rectIntersect(Rect{xc - r, yc - r, xc + r, yc + r}, fb.bounds());
+}
+
+// contorno: trechos no framebuffer registrado e, como quads, na GL
+void drawCircleBresenham(int xc, int yc, int r, const Color &c){
+    if(r < 0) return;
+    glColor4ub(c.r,c.g,c.b,c.a);
+    glBegin(GL_QUADS);
+    circleRuns(xc, yc, r, [&](int x0, int y0, int x1, int y1){
+        if(g_fb){
+            if(y0 == y1) g_fb->fillSpan(y0, x0, x1, c);
+            else g_fb->fillColumn(x0, y0, y1, c);
+        }
+        glVertex2i(x0, y0);
+        glVertex2i(x1 + 1, y0);
+        glVertex2i(x1 + 1, y1 + 1);
+        glVertex2i(x0, y1 + 1);
+    });
+    glEnd();
+}
+
+void fillCircleBresenham(int xc, int yc, int r, const Color &c){
+    if(r < 0) return;
+    static thread_local std::vector<Span> spans;
+    spans.clear();
+    discSpans(xc, yc, r, [&](int y, int x0, int x1){
+        if(g_fb) g_fb->fillSpan(y, x0, x1, c);
+        spans.push_back(Span{y, x0, x1});
+    });
+    submitSpansGL(spans, c);
+}
@@ -1,18 +1,33 @@
 #pragma once
 #include <vector>
 #include <cstdint>
+#include "span.h"
+#include "framebuffer.h"
 
-struct Color {
-    uint8_t r,g,b,a;
-    Color(uint8_t r_=0,uint8_t g_=0,uint8_t b_=0,uint8_t a_=255):r(r_),g(g_),b(b_),a(a_){}
-    bool operator==(const Color& o) const { return r==o.r && g==o.g && b==o.b && a==o.a; }
-};
-
+void setFrameBuffer(Framebuffer* fb); // registrar um Framebuffer (nullptr = nenhum)
+Framebuffer* getFrameBuffer();        // framebuffer registrado (nullptr se nenhum)
 void setFrameBufferPointer(Color* ptr, int w, int h); // apontar framebuffer externo
+Color* getFrameBufferPointer(int &w, int &h); // memória do framebuffer registrado (nullptr se nenhum; na ordem do layout)
+// envia a região [x0,x1]x[y0,y1] do framebuffer registrado à tela com um único glDrawPixels
+// (no layout em blocos a região é antes convertida para linear)
+void uploadFrameBufferRegion(int x0, int y0, int x1, int y1);
 void putPixel(int x, int y, const Color &c, bool glDraw=true);
 
+// linha horizontal [x0,x1] em y escrita direto no framebuffer registrado (recortada uma vez)
+void drawHLine(int y, int x0, int x1, const Color &c);
+// envia spans de uma cor à tela numa única submissão GL (quads de 1 pixel de altura)
+void submitSpansGL(const std::vector<Span>& spans, const Color &c);
+
 // Bresenham - redução ao primeiro octante (usa glBegin(GL_POINTS) internamente quando glDraw=true)
 void drawLineBresenham(int x0, int y0, int x1, int y1, const Color &c);
 
-// Bresenham circle (midpoint / Bresenham)
-void drawCircleBresenham(int xc, int yc, int radius, const Color &c);
\ No newline at end of file
+// Bresenham circle (midpoint / Bresenham); o contorno sai em trechos por
+// octante (horizontais e verticais), escritos de uma vez e enviados como quads
+void drawCircleBresenham(int xc, int yc, int radius, const Color &c);
+// disco com as mesmas decisões de drawCircleBresenham: um span por linha, O(r)
+// spans em vez de percorrer os pixels como o flood fill
+void fillCircleBresenham(int xc, int yc, int radius, const Color &c);
+
+// núcleos sem GL: só escrevem em fb (recortados); devolvem a região alterada
+Rect circleToBuffer(Framebuffer& fb, int xc, int yc, int radius, const Color &c);
+Rect discToBuffer(Framebuffer& fb, int xc, int yc, int radius, const Color &c);
@@ -6,11 +6,14 @@
 void LineShape::draw(const Color &c){
     drawLineBresenham(a.first, a.second, b.first, b.second, c);
 }
-void LineShape::transform(const std::vector<Point>& (*tf)(const std::vector<Point>&)){
-    std::vector<Point> in = {{(float)a.first, (float)a.second}, {(float)b.first, (float)b.second}};
-    std::vector<Point> out = tf(in);
-    a.first = (int)std::round(out[0].first); a.second = (int)std::round(out[0].second);
-    b.first = (int)std::round(out[1].first); b.second = (int)std::round(out[1].second);
+static Point toPoint(IPoint p){ return Point((float)p.first, (float)p.second); }
+static IPoint toIPoint(const Point& p){ return IPoint((int)std::round(p.first), (int)std::round(p.second)); }
+
+void LineShape::transform(PointTransformRef tf){
+    Point p[2] = {toPoint(a), toPoint(b)};
+    tf(p, 2);
+    a = toIPoint(p[0]);
+    b = toIPoint(p[1]);
 }
 
 void PolygonShape::draw(const Color &c){
@@ -25,24 +28,32 @@ void PolygonShape::fill(const Color &c){
     std::vector<std::pair<int,int>> poly(pts.begin(), pts.end());
     fillPolygonScanline(poly, c);
 }
-void PolygonShape::transform(const std::vector<Point>& (*tf)(const std::vector<Point>&)){
-    std::vector<Point> in;
-    for(auto &p: pts) in.emplace_back((float)p.first, (float)p.second);
-    auto out = tf(in);
-    for(size_t i=0;i<pts.size();++i){
-        pts[i].first = (int)std::round(out[i].first);
-        pts[i].second = (int)std::round(out[i].second);
-    }
+void PolygonShape::transform(PointTransformRef tf){
+    static thread_local std::vector<Point> buf; // reaproveitado entre chamadas
+    buf.resize(pts.size());
+    for(size_t i=0;i<pts.size();++i) buf[i] = toPoint(pts[i]);
+    tf(buf.data(), buf.size());
+    for(size_t i=0;i<pts.size();++i) pts[i] = toIPoint(buf[i]);
 }
 
 void CircleShape::draw(const Color &c){
     drawCircleBresenham(center.first, center.second, radius, c);
 }
-void CircleShape::transform(const std::vector<Point>& (*tf)(const std::vector<Point>&)){
-    std::vector<Point> in = {{(float)center.first,(float)center.second}};
-    auto out = tf(in);
-    center.first = (int)std::round(out[0].first);
-    center.second = (int)std::round(out[0].second);
-    // scaling radius: se tf contém escala uniforme na volta do centro (0,0) -> perdemos info.
-    // Para suportar escala: estimar novo raio aplicando escala ao ponto (center+radius, center) e computar distância.
+void CircleShape::fill(const Color &c){
+    fillCircleBresenham(center.first, center.second, radius, c);
+}
+void CircleShape::transform(PointTransformRef tf){
+    // centro e as pontas de dois raios ortogonais: u e v transformados dão a
+    // parte linear de tf, e o novo raio preserva a área (sqrt|u x v|). Com
+    // escala uniforme, rotação ou reflexão é exatamente o raio escalado; com
+    // escala não uniforme o círculo vira o de mesma área da elipse.
+    float cx = (float)center.first, cy = (float)center.second, r = (float)radius;
+    Point p[3] = {Point(cx, cy), Point(cx + r, cy), Point(cx, cy + r)};
+    tf(p, 3);
+    center = toIPoint(p[0]);
+    if(radius > 0){
+        double ux = p[1].first - p[0].first, uy = p[1].second - p[0].second;
+        double vx = p[2].first - p[0].first, vy = p[2].second - p[0].second;
+        radius = (int)std::round(std::sqrt(std::fabs(ux * vy - uy * vx)));
+    }
 }
\ No newline at end of file
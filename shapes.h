@@ -1,16 +1,52 @@
 #pragma once
 #include "rasterizer.h"
 #include "transforms.h"
+#include <cstddef>
+#include <type_traits>
 #include <vector>
 #include <utility>
 
 using IPoint = std::pair<int,int>;
 using PointF = std::pair<float,float>;
 
+// Referência (sem posse e sem alocação) a uma transformação de pontos. Aceita:
+//  - uma função de ponto: Point f(const Point&) (lambda, Affine2D, ...);
+//  - uma função de lote: void f(Point* pts, size_t n), em lugar (por exemplo
+//    [&](Point* p, size_t n){ rotate(p, n, 30.0f, cx, cy); }).
+// O laço sobre os vértices é instanciado para o tipo do callable, então o
+// compilador pode expandir a transformação dentro dele: só há uma chamada
+// indireta por forma. O callable deve viver até o fim da chamada.
+class PointTransformRef {
+public:
+    template<class F, class = typename std::enable_if<
+        !std::is_same<typename std::decay<F>::type, PointTransformRef>::value>::type>
+    PointTransformRef(const F& f) : m_obj(&f), m_fn(&thunk<F>) {}
+
+    void operator()(Point* pts, size_t n) const { m_fn(m_obj, pts, n); }
+
+private:
+    template<class F>
+    static auto apply(const F& f, Point* pts, size_t n, int) -> decltype(f(pts, n), void()) {
+        f(pts, n);
+    }
+    template<class F>
+    static void apply(const F& f, Point* pts, size_t n, long) {
+        for(size_t i = 0; i < n; ++i) pts[i] = f(pts[i]);
+    }
+    template<class F>
+    static void thunk(const void* obj, Point* pts, size_t n) {
+        apply(*static_cast<const F*>(obj), pts, n, 0);
+    }
+
+    const void* m_obj;
+    void (*m_fn)(const void*, Point*, size_t);
+};
+
 struct Shape {
     virtual void draw(const Color &c) = 0;
     virtual void fill(const Color &c) = 0;
-    virtual void transform(const std::vector<Point>& (*tf)(const std::vector<Point>&)) = 0;
+    // aplica tf aos vértices (em float) e arredonda de volta para inteiros
+    virtual void transform(PointTransformRef tf) = 0;
     virtual ~Shape() = default;
 };
 
@@ -19,7 +55,7 @@ struct LineShape : public Shape {
     LineShape(IPoint a_, IPoint b_):a(a_),b(b_){}
     void draw(const Color &c) override;
     void fill(const Color &c) override {}
-    void transform(const std::vector<Point>& (*tf)(const std::vector<Point>&)) override;
+    void transform(PointTransformRef tf) override;
 };
 
 struct PolygonShape : public Shape {
@@ -27,14 +63,14 @@ struct PolygonShape : public Shape {
     PolygonShape(const std::vector<IPoint>& p):pts(p){}
     void draw(const Color &c) override;
     void fill(const Color &c) override;
-    void transform(const std::vector<Point>& (*tf)(const std::vector<Point>&)) override;
+    void transform(PointTransformRef tf) override;
 };
 
 struct CircleShape : public Shape {
     IPoint center;
-    int radius;
+    int radius; // atualizado pela escala (ver transform)
     CircleShape(IPoint c_, int r_):center(c_),radius(r_){}
     void draw(const Color &c) override;
-    void fill(const Color &c) override {} // especificado: não preencher via scanline
-    void transform(const std::vector<Point>& (*tf)(const std::vector<Point>&)) override;
+    void fill(const Color &c) override; // disco em spans (fillCircleBresenham), não via scanline
+    void transform(PointTransformRef tf) override;
 };
\ No newline at end of file
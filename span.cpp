@@ -0,0 +1,33 @@
+#include "span.h"
+#include <algorithm>
+
+void SpanList::normalize(){
+    if(spans.size() < 2) return;
+    std::sort(spans.begin(), spans.end(), [](const Span &a, const Span &b){
+        return a.y != b.y ? a.y < b.y : a.x0 < b.x0;
+    });
+    size_t out = 0;
+    for(size_t i = 1; i < spans.size(); ++i){
+        Span &cur = spans[out];
+        const Span &s = spans[i];
+        if(s.y == cur.y && s.x0 <= cur.x1 + 1){
+            cur.x1 = std::max(cur.x1, s.x1);
+        } else {
+            spans[++out] = s;
+        }
+    }
+    spans.resize(out + 1);
+}
+
+Rect SpanList::bounds() const {
+    Rect b = emptyRect();
+    for(auto &s: spans) b = rectUnion(b, Rect{s.x0, s.y, s.x1, s.y});
+    return b;
+}
+
+void SpanList::rowRange(int y0, int y1, size_t &first, size_t &last) const {
+    auto lo = std::lower_bound(spans.begin(), spans.end(), y0, [](const Span &s, int y){ return s.y < y; });
+    auto hi = std::upper_bound(lo, spans.end(), y1, [](int y, const Span &s){ return y < s.y; });
+    first = (size_t)(lo - spans.begin());
+    last = (size_t)(hi - spans.begin());
+}
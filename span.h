@@ -0,0 +1,44 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include "damage.h"
+
+// Trecho horizontal de pixels [x0,x1] na linha y
+struct Span {
+    int y, x0, x1;
+};
+
+// Lista de spans produzida por um rasterizador. Pixels consecutivos na mesma
+// linha já são agrupados na inserção; normalize() deixa a lista ordenada por
+// linha e sem sobreposições, o que permite localizar as linhas de uma região
+// por busca binária.
+struct SpanList {
+    std::vector<Span> spans;
+
+    void clear(){ spans.clear(); }
+    bool empty() const { return spans.empty(); }
+    size_t size() const { return spans.size(); }
+
+    void addPixel(int x, int y){
+        if(!spans.empty()){
+            Span &s = spans.back();
+            if(s.y == y){
+                if(x == s.x1 + 1){ s.x1 = x; return; }
+                if(x == s.x0 - 1){ s.x0 = x; return; }
+                if(x >= s.x0 && x <= s.x1) return;
+            }
+        }
+        spans.push_back(Span{y, x, x});
+    }
+    void addSpan(int y, int x0, int x1){
+        if(x0 > x1) return;
+        spans.push_back(Span{y, x0, x1});
+    }
+
+    // ordena por (y, x0) e funde spans sobrepostos ou adjacentes
+    void normalize();
+    // caixa envolvente de todos os spans
+    Rect bounds() const;
+    // índices [first,last) dos spans com y em [y0,y1] (lista normalizada)
+    void rowRange(int y0, int y1, size_t &first, size_t &last) const;
+};
@@ -0,0 +1,128 @@
+#include "spankernel.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SPAN_X86 1
+#include <emmintrin.h>
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// GCC/Clang só aceitam intrínsecas AVX2 em funções marcadas para esse alvo;
+// o MSVC aceita sem flags.
+#if defined(SPAN_X86) && (defined(__GNUC__) || defined(__clang__))
+#define SPAN_TARGET_SSE2 __attribute__((target("sse2")))
+#define SPAN_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SPAN_TARGET_SSE2
+#define SPAN_TARGET_AVX2
+#endif
+
+typedef void (*Fill32Fn)(uint32_t*, size_t, uint32_t);
+
+// ---- escalar ----
+
+static void fill32Scalar(uint32_t* dst, size_t n, uint32_t value){
+    for(size_t i = 0; i < n; ++i) dst[i] = value;
+}
+
+#ifdef SPAN_X86
+
+// ---- SSE2: 16 pixels de 32 bits por iteração ----
+
+SPAN_TARGET_SSE2
+static void fill32SSE2(uint32_t* dst, size_t n, uint32_t value){
+    const __m128i v = _mm_set1_epi32((int)value);
+    size_t i = 0;
+    for(; i + 16 <= n; i += 16){
+        _mm_storeu_si128((__m128i*)(dst + i), v);
+        _mm_storeu_si128((__m128i*)(dst + i + 4), v);
+        _mm_storeu_si128((__m128i*)(dst + i + 8), v);
+        _mm_storeu_si128((__m128i*)(dst + i + 12), v);
+    }
+    for(; i + 4 <= n; i += 4) _mm_storeu_si128((__m128i*)(dst + i), v);
+    fill32Scalar(dst + i, n - i, value);
+}
+
+// ---- AVX2: 32 pixels de 32 bits por iteração ----
+// As sobras são tratadas aqui mesmo (stores de 128 bits em codificação VEX e
+// escalar): chamar a versão SSE2 com os registradores YMM sujos custa uma
+// transição AVX->SSE em várias CPUs.
+
+SPAN_TARGET_AVX2
+static void fill32AVX2(uint32_t* dst, size_t n, uint32_t value){
+    const __m256i v = _mm256_set1_epi32((int)value);
+    size_t i = 0;
+    for(; i + 32 <= n; i += 32){
+        _mm256_storeu_si256((__m256i*)(dst + i), v);
+        _mm256_storeu_si256((__m256i*)(dst + i + 8), v);
+        _mm256_storeu_si256((__m256i*)(dst + i + 16), v);
+        _mm256_storeu_si256((__m256i*)(dst + i + 24), v);
+    }
+    for(; i + 8 <= n; i += 8) _mm256_storeu_si256((__m256i*)(dst + i), v);
+    if(i + 4 <= n){ _mm_storeu_si128((__m128i*)(dst + i), _mm256_castsi256_si128(v)); i += 4; }
+    fill32Scalar(dst + i, n - i, value);
+}
+
+#endif // SPAN_X86
+
+SpanKernelISA detectSpanKernelISA(){
+#ifdef SPAN_X86
+    bool sse2 = false, avx2 = false;
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    sse2 = ((info[3] >> 26) & 1) != 0;
+    bool osxsave = ((info[2] >> 27) & 1) != 0;
+    bool avx = ((info[2] >> 28) & 1) != 0;
+    if(maxLeaf >= 7){
+        __cpuidex(info, 7, 0);
+        avx2 = ((info[1] >> 5) & 1) != 0;
+    }
+    // o SO precisa salvar os registradores YMM
+    if(avx2 && !(osxsave && avx && (_xgetbv(0) & 6) == 6)) avx2 = false;
+#else
+    __builtin_cpu_init();
+    sse2 = __builtin_cpu_supports("sse2");
+    avx2 = __builtin_cpu_supports("avx2");
+#endif
+    if(avx2) return SPAN_ISA_AVX2;
+    if(sse2) return SPAN_ISA_SSE2;
+#endif
+    return SPAN_ISA_SCALAR;
+}
+
+static SpanKernelISA g_isa = SPAN_ISA_SCALAR;
+static Fill32Fn g_fill32 = fill32Scalar;
+
+void setSpanKernelISA(SpanKernelISA isa){
+    static const SpanKernelISA best = detectSpanKernelISA();
+    if(isa > best) isa = best;
+    g_isa = isa;
+    g_fill32 = fill32Scalar;
+#ifdef SPAN_X86
+    if(isa == SPAN_ISA_SSE2) g_fill32 = fill32SSE2;
+    if(isa == SPAN_ISA_AVX2) g_fill32 = fill32AVX2;
+#endif
+}
+
+// escolhe os kernels na inicialização estática, antes de qualquer thread de desenho
+static const bool g_kernelsBound = (setSpanKernelISA(SPAN_ISA_AVX2), true);
+
+SpanKernelISA getSpanKernelISA(){ return g_isa; }
+
+const char* spanKernelISAName(SpanKernelISA isa){
+    switch(isa){
+    case SPAN_ISA_SCALAR: return "escalar";
+    case SPAN_ISA_SSE2: return "SSE2";
+    case SPAN_ISA_AVX2: return "AVX2";
+    default: return "?";
+    }
+}
+
+void spanFill32(uint32_t* dst, size_t n, uint32_t value){
+    g_fill32(dst, n, value);
+}
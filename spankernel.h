@@ -0,0 +1,22 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Kernels de preenchimento de spans horizontais. Cada operação tem uma versão
+// escalar, SSE2 e AVX2; a melhor suportada pela CPU é escolhida na primeira
+// chamada (ou forçada com setSpanKernelISA, usado pelos benchmarks).
+
+enum SpanKernelISA {
+    SPAN_ISA_SCALAR = 0,
+    SPAN_ISA_SSE2,
+    SPAN_ISA_AVX2,
+    SPAN_ISA_COUNT
+};
+
+SpanKernelISA detectSpanKernelISA();   // melhor conjunto suportado pela CPU/compilador
+SpanKernelISA getSpanKernelISA();      // conjunto em uso
+void setSpanKernelISA(SpanKernelISA isa); // força um conjunto (limitado ao detectado)
+const char* spanKernelISAName(SpanKernelISA isa);
+
+// n pixels de 32 bits com o mesmo valor (Color::packed(), ver framebuffer.h)
+void spanFill32(uint32_t* dst, size_t n, uint32_t value);
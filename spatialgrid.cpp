@@ -0,0 +1,66 @@
+#include "spatialgrid.h"
+#include <algorithm>
+
+void SpatialGrid::reset(int w, int h, int cellShift){
+    m_w = std::max(w, 0);
+    m_h = std::max(h, 0);
+    m_shift = cellShift;
+    int mask = (1 << m_shift) - 1;
+    m_cols = (m_w + mask) >> m_shift;
+    m_rows = (m_h + mask) >> m_shift;
+    m_cells.assign((size_t)m_cols * m_rows, std::vector<uint32_t>());
+    m_bounds.clear();
+}
+
+void SpatialGrid::clear(){
+    for(auto &c: m_cells) c.clear();
+    m_bounds.clear();
+}
+
+bool SpatialGrid::cellRange(const Rect& r, int& cx0, int& cy0, int& cx1, int& cy1) const {
+    Rect q = rectIntersect(r, Rect{0, 0, m_w - 1, m_h - 1});
+    if(q.empty()) return false;
+    cx0 = q.x0 >> m_shift; cx1 = q.x1 >> m_shift;
+    cy0 = q.y0 >> m_shift; cy1 = q.y1 >> m_shift;
+    return true;
+}
+
+void SpatialGrid::insert(uint32_t id, const Rect& r){
+    if(id >= m_bounds.size()) m_bounds.resize(id + 1, emptyRect());
+    m_bounds[id] = r;
+    int cx0, cy0, cx1, cy1;
+    if(!cellRange(r, cx0, cy0, cx1, cy1)) return;
+    for(int cy = cy0; cy <= cy1; ++cy)
+        for(int cx = cx0; cx <= cx1; ++cx)
+            m_cells[(size_t)cy * m_cols + cx].push_back(id);
+}
+
+void SpatialGrid::remove(uint32_t id){
+    if(id >= m_bounds.size()) return;
+    int cx0, cy0, cx1, cy1;
+    if(cellRange(m_bounds[id], cx0, cy0, cx1, cy1)){
+        for(int cy = cy0; cy <= cy1; ++cy)
+            for(int cx = cx0; cx <= cx1; ++cx){
+                std::vector<uint32_t>& c = m_cells[(size_t)cy * m_cols + cx];
+                auto it = std::find(c.begin(), c.end(), id);
+                if(it != c.end()){ *it = c.back(); c.pop_back(); }
+            }
+    }
+    m_bounds[id] = emptyRect();
+}
+
+void SpatialGrid::update(uint32_t id, const Rect& r){
+    remove(id);
+    insert(id, r);
+}
+
+void SpatialGrid::query(int x, int y, std::vector<uint32_t>& out) const {
+    out.clear();
+    if(x < 0 || y < 0 || x >= m_w || y >= m_h) return;
+    const std::vector<uint32_t>& c = m_cells[(size_t)(y >> m_shift) * m_cols + (x >> m_shift)];
+    for(uint32_t id: c){
+        const Rect& b = m_bounds[id];
+        if(x >= b.x0 && x <= b.x1 && y >= b.y0 && y <= b.y1)
+            out.push_back(id);
+    }
+}
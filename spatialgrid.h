@@ -0,0 +1,35 @@
+#pragma once
+#include "damage.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Índice espacial em grade uniforme: a área [0,w) x [0,h) é dividida em células
+// de 2^cellShift pixels e cada objeto (identificado pelo seu índice) é anotado em
+// todas as células que a sua caixa envolvente toca. Uma consulta por ponto só
+// olha a lista de uma célula, então o custo depende da densidade local e não do
+// número total de objetos. Caixas fora da área ficam guardadas, mas não entram em
+// nenhuma célula (a área é a da janela: só há consultas dentro dela).
+class SpatialGrid {
+public:
+    // nova área; descarta todos os objetos
+    void reset(int w, int h, int cellShift = 5);
+    void clear();
+
+    // id pode ser qualquer índice; normalmente o da forma no vetor de formas
+    void insert(uint32_t id, const Rect& r);
+    void update(uint32_t id, const Rect& r);
+    void remove(uint32_t id);
+
+    const Rect& bounds(uint32_t id) const { return m_bounds[id]; }
+
+    // ids cujas caixas contêm (x,y), em ordem arbitrária
+    void query(int x, int y, std::vector<uint32_t>& out) const;
+
+private:
+    bool cellRange(const Rect& r, int& cx0, int& cy0, int& cx1, int& cy1) const;
+
+    int m_w = 0, m_h = 0, m_shift = 5, m_cols = 0, m_rows = 0;
+    std::vector<std::vector<uint32_t>> m_cells; // [cy * m_cols + cx]
+    std::vector<Rect> m_bounds;                 // por id (vazio: ausente)
+};
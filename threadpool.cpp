@@ -0,0 +1,108 @@
+#include "threadpool.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+thread_local bool t_inParallel = false; // dentro de um parallelFor (worker ou chamadora)
+
+class ThreadPool {
+public:
+    ThreadPool(){
+        unsigned hc = std::thread::hardware_concurrency();
+        unsigned workers = hc > 1 ? hc - 1 : 0;
+        for(unsigned i = 0; i < workers; ++i)
+            m_threads.emplace_back([this]{ workerLoop(); });
+    }
+    ~ThreadPool(){
+        {
+            std::lock_guard<std::mutex> lk(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        for(auto &t: m_threads) t.join();
+    }
+
+    unsigned size() const { return (unsigned)m_threads.size() + 1; }
+
+    void run(size_t n, ParallelBody fn){
+        // um laço por vez; quem chega com o pool ocupado roda em série
+        std::unique_lock<std::mutex> busy(m_runMutex, std::try_to_lock);
+        if(!busy.owns_lock() || m_threads.empty()){
+            for(size_t i = 0; i < n; ++i) fn(i);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lk(m_mutex);
+            m_fn = &fn;
+            m_n = n;
+            m_next = 0;
+            m_active = (unsigned)m_threads.size();
+            ++m_generation;
+        }
+        m_wake.notify_all();
+        t_inParallel = true;
+        drain(fn, n);
+        t_inParallel = false;
+        std::unique_lock<std::mutex> lk(m_mutex);
+        m_done.wait(lk, [this]{ return m_active == 0; });
+        m_fn = nullptr;
+    }
+
+private:
+    void drain(ParallelBody fn, size_t n){
+        for(;;){
+            size_t i = m_next.fetch_add(1, std::memory_order_relaxed);
+            if(i >= n) return;
+            fn(i);
+        }
+    }
+
+    void workerLoop(){
+        t_inParallel = true;
+        unsigned long seen = 0;
+        std::unique_lock<std::mutex> lk(m_mutex);
+        for(;;){
+            m_wake.wait(lk, [&]{ return m_stop || m_generation != seen; });
+            if(m_stop) return;
+            seen = m_generation;
+            const ParallelBody* fn = m_fn;
+            size_t n = m_n;
+            lk.unlock();
+            drain(*fn, n);
+            lk.lock();
+            if(--m_active == 0) m_done.notify_one();
+        }
+    }
+
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex, m_runMutex;
+    std::condition_variable m_wake, m_done;
+    const ParallelBody* m_fn = nullptr;
+    size_t m_n = 0;
+    std::atomic<size_t> m_next{0};
+    unsigned m_active = 0;
+    unsigned long m_generation = 0;
+    bool m_stop = false;
+};
+
+ThreadPool& pool(){
+    static ThreadPool p;
+    return p;
+}
+
+} // namespace
+
+unsigned threadPoolSize(){ return pool().size(); }
+
+void parallelFor(size_t n, ParallelBody fn){
+    if(n == 0) return;
+    if(n == 1 || t_inParallel){
+        for(size_t i = 0; i < n; ++i) fn(i);
+        return;
+    }
+    pool().run(n, fn);
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <type_traits>
+
+// Pool fixo de threads para laços paralelos. As threads são criadas na primeira
+// chamada (uma a menos que os núcleos; a thread chamadora também trabalha) e
+// ficam dormindo entre as chamadas.
+
+// número de threads que executam um parallelFor (inclui a chamadora)
+unsigned threadPoolSize();
+
+// Referência não-dona a um callable void(size_t), como PointTransformRef em
+// shapes.h: guarda só o endereço do objeto e uma função que o chama. Ao
+// contrário de std::function, nunca aloca (lambdas com mais de 16 bytes de
+// capturas iam para o heap a cada chamada); o callable só precisa viver até o
+// parallelFor retornar, o que vale para o lambda temporário do argumento.
+class ParallelBody {
+public:
+    template<class F, class = typename std::enable_if<
+        !std::is_same<typename std::decay<F>::type, ParallelBody>::value>::type>
+    ParallelBody(const F& f) : m_obj(&f), m_fn(&thunk<F>) {}
+
+    void operator()(size_t i) const { m_fn(m_obj, i); }
+
+private:
+    template<class F>
+    static void thunk(const void* obj, size_t i) { (*static_cast<const F*>(obj))(i); }
+
+    const void* m_obj;
+    void (*m_fn)(const void*, size_t);
+};
+
+// executa fn(i) para todo i em [0,n), distribuindo os índices dinamicamente
+// entre as threads, e retorna quando todos terminarem. Chamadas aninhadas (de
+// dentro de fn) ou com n == 1 rodam em série na thread atual.
+void parallelFor(size_t n, ParallelBody fn);
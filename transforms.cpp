@@ -5,62 +5,181 @@
 #define M_PI 3.14159265358979323846
 #endif
 
+// As versões que retornam vetor só alocam a saída e chamam a versão in -> out
+
 std::vector<Point> translate(const std::vector<Point>& pts, float dx, float dy){
-    std::vector<Point> out; out.reserve(pts.size());
-    for(auto &p: pts) out.emplace_back(p.first + dx, p.second + dy);
+    std::vector<Point> out(pts.size());
+    translate(pts.data(), pts.size(), out.data(), dx, dy);
     return out;
 }
 
 std::vector<Point> scale(const std::vector<Point>& pts, float sx, float sy, float cx, float cy){
-    std::vector<Point> out; out.reserve(pts.size());
-    for(auto &p: pts){
-        float x = (p.first - cx) * sx + cx;
-        float y = (p.second - cy) * sy + cy;
-        out.emplace_back(x,y);
-    }
+    std::vector<Point> out(pts.size());
+    scale(pts.data(), pts.size(), out.data(), sx, sy, cx, cy);
     return out;
 }
 
 std::vector<Point> rotate(const std::vector<Point>& pts, float angle_deg, float cx, float cy){
+    std::vector<Point> out(pts.size());
+    rotate(pts.data(), pts.size(), out.data(), angle_deg, cx, cy);
+    return out;
+}
+
+std::vector<Point> shear(const std::vector<Point>& pts, float shx, float shy, float cx, float cy){
+    std::vector<Point> out(pts.size());
+    shear(pts.data(), pts.size(), out.data(), shx, shy, cx, cy);
+    return out;
+}
+
+std::vector<Point> reflectX(const std::vector<Point>& pts, float cx){
+    std::vector<Point> out(pts.size());
+    reflectX(pts.data(), pts.size(), out.data(), cx);
+    return out;
+}
+
+std::vector<Point> reflectY(const std::vector<Point>& pts, float cy){
+    std::vector<Point> out(pts.size());
+    reflectY(pts.data(), pts.size(), out.data(), cy);
+    return out;
+}
+
+// in -> out (out pode ser igual a in: cada ponto é lido antes de ser escrito)
+
+void translate(const Point* in, size_t n, Point* out, float dx, float dy){
+    for(size_t i = 0; i < n; ++i)
+        out[i] = Point(in[i].first + dx, in[i].second + dy);
+}
+
+void scale(const Point* in, size_t n, Point* out, float sx, float sy, float cx, float cy){
+    for(size_t i = 0; i < n; ++i){
+        float x = (in[i].first - cx) * sx + cx;
+        float y = (in[i].second - cy) * sy + cy;
+        out[i] = Point(x, y);
+    }
+}
+
+void rotate(const Point* in, size_t n, Point* out, float angle_deg, float cx, float cy){
     float a = angle_deg * static_cast<float>(M_PI) / 180.0f;
     float ca = cos(a), sa = sin(a);
-    std::vector<Point> out; out.reserve(pts.size());
-    for(auto &p: pts){
-        float x = p.first - cx;
-        float y = p.second - cy;
+    for(size_t i = 0; i < n; ++i){
+        float x = in[i].first - cx;
+        float y = in[i].second - cy;
         float xr = x * ca - y * sa;
         float yr = x * sa + y * ca;
-        out.emplace_back(xr + cx, yr + cy);
+        out[i] = Point(xr + cx, yr + cy);
     }
-    return out;
 }
 
-std::vector<Point> shear(const std::vector<Point>& pts, float shx, float shy, float cx, float cy){
-    std::vector<Point> out; out.reserve(pts.size());
-    for(auto &p: pts){
-        float x = p.first - cx;
-        float y = p.second - cy;
+void shear(const Point* in, size_t n, Point* out, float shx, float shy, float cx, float cy){
+    for(size_t i = 0; i < n; ++i){
+        float x = in[i].first - cx;
+        float y = in[i].second - cy;
         float xs = x + shx * y;
         float ys = shy * x + y;
-        out.emplace_back(xs + cx, ys + cy);
+        out[i] = Point(xs + cx, ys + cy);
     }
-    return out;
 }
 
-std::vector<Point> reflectX(const std::vector<Point>& pts, float cx){
-    std::vector<Point> out; out.reserve(pts.size());
-    for(auto &p: pts){
-        float x = 2*cx - p.first;
-        out.emplace_back(x, p.second);
-    }
-    return out;
+void reflectX(const Point* in, size_t n, Point* out, float cx){
+    for(size_t i = 0; i < n; ++i)
+        out[i] = Point(2*cx - in[i].first, in[i].second);
 }
 
-std::vector<Point> reflectY(const std::vector<Point>& pts, float cy){
-    std::vector<Point> out; out.reserve(pts.size());
-    for(auto &p: pts){
-        float y = 2*cy - p.second;
-        out.emplace_back(p.first, y);
+void reflectY(const Point* in, size_t n, Point* out, float cy){
+    for(size_t i = 0; i < n; ++i)
+        out[i] = Point(in[i].first, 2*cy - in[i].second);
+}
+
+// em lugar
+
+void translate(Point* pts, size_t n, float dx, float dy){ translate(pts, n, pts, dx, dy); }
+void scale(Point* pts, size_t n, float sx, float sy, float cx, float cy){ scale(pts, n, pts, sx, sy, cx, cy); }
+void rotate(Point* pts, size_t n, float angle_deg, float cx, float cy){ rotate(pts, n, pts, angle_deg, cx, cy); }
+void shear(Point* pts, size_t n, float shx, float shy, float cx, float cy){ shear(pts, n, pts, shx, shy, cx, cy); }
+void reflectX(Point* pts, size_t n, float cx){ reflectX(pts, n, pts, cx); }
+void reflectY(Point* pts, size_t n, float cy){ reflectY(pts, n, pts, cy); }
+
+// composição
+
+namespace {
+
+// x' = m[0]*x + m[1]*y + m[2];  y' = m[3]*x + m[4]*y + m[5]
+struct Affine { double m[6]; };
+
+// aplica L (linear 2x2 em torno de c) depois de A: T(c) * L * T(-c) * A
+void applyAbout(Affine& A, double l00, double l01, double l10, double l11, double cx, double cy){
+    const double* m = A.m;
+    double tx = m[2] - cx, ty = m[5] - cy;
+    Affine R;
+    R.m[0] = l00 * m[0] + l01 * m[3];
+    R.m[1] = l00 * m[1] + l01 * m[4];
+    R.m[2] = l00 * tx + l01 * ty + cx;
+    R.m[3] = l10 * m[0] + l11 * m[3];
+    R.m[4] = l10 * m[1] + l11 * m[4];
+    R.m[5] = l10 * tx + l11 * ty + cy;
+    A = R;
+}
+
+Affine fold(const PointOp* ops, size_t nops){
+    Affine A = {{1, 0, 0, 0, 1, 0}};
+    for(size_t k = 0; k < nops; ++k){
+        const PointOp& op = ops[k];
+        switch(op.kind){
+        case PointOp::TRANSLATE:
+            A.m[2] += op.a;
+            A.m[5] += op.b;
+            break;
+        case PointOp::SCALE:
+            applyAbout(A, op.a, 0, 0, op.b, op.cx, op.cy);
+            break;
+        case PointOp::ROTATE: {
+            double a = op.a * M_PI / 180.0;
+            double ca = std::cos(a), sa = std::sin(a);
+            applyAbout(A, ca, -sa, sa, ca, op.cx, op.cy);
+            break;
+        }
+        case PointOp::SHEAR:
+            applyAbout(A, 1, op.a, op.b, 1, op.cx, op.cy);
+            break;
+        case PointOp::REFLECT_X:
+            applyAbout(A, -1, 0, 0, 1, op.cx, 0);
+            break;
+        case PointOp::REFLECT_Y:
+            applyAbout(A, 1, 0, 0, -1, 0, op.cy);
+            break;
+        }
     }
+    return A;
+}
+
+} // namespace
+
+Affine2D composeAffine(const PointOp* ops, size_t nops){
+    Affine A = fold(ops, nops);
+    return Affine2D{(float)A.m[0], (float)A.m[1], (float)A.m[2],
+                    (float)A.m[3], (float)A.m[4], (float)A.m[5]};
+}
+
+Affine2D composeAffine(std::initializer_list<PointOp> ops){
+    return composeAffine(ops.begin(), ops.size());
+}
+
+void compose(const Point* in, size_t n, Point* out, const PointOp* ops, size_t nops){
+    const Affine2D A = composeAffine(ops, nops);
+    for(size_t i = 0; i < n; ++i)
+        out[i] = A(in[i]);
+}
+
+void compose(Point* pts, size_t n, const PointOp* ops, size_t nops){
+    compose(pts, n, pts, ops, nops);
+}
+
+void compose(Point* pts, size_t n, std::initializer_list<PointOp> ops){
+    compose(pts, n, pts, ops.begin(), ops.size());
+}
+
+std::vector<Point> compose(const std::vector<Point>& pts, std::initializer_list<PointOp> ops){
+    std::vector<Point> out(pts.size());
+    compose(pts.data(), pts.size(), out.data(), ops.begin(), ops.size());
     return out;
 }
\ No newline at end of file
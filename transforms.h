@@ -2,6 +2,8 @@
 #include <vector>
 #include <utility>
 #include <cmath>
+#include <cstddef>
+#include <initializer_list>
 
 // Operamos com pares (x,y)
 using Point = std::pair<float,float>;
@@ -12,4 +14,55 @@ std::vector<Point> scale(const std::vector<Point>& pts, float sx, float sy, floa
 std::vector<Point> rotate(const std::vector<Point>& pts, float angle_deg, float cx=0.0f, float cy=0.0f);
 std::vector<Point> shear(const std::vector<Point>& pts, float shx, float shy, float cx=0.0f, float cy=0.0f);
 std::vector<Point> reflectX(const std::vector<Point>& pts, float cx=0.0f);
-std::vector<Point> reflectY(const std::vector<Point>& pts, float cy=0.0f);
\ No newline at end of file
+std::vector<Point> reflectY(const std::vector<Point>& pts, float cy=0.0f);
+
+// Versões sem alocação sobre n pontos contíguos: em lugar (pts) ou de in para
+// out (out pode ser igual a in). Mesmo resultado das versões acima.
+void translate(Point* pts, size_t n, float dx, float dy);
+void translate(const Point* in, size_t n, Point* out, float dx, float dy);
+void scale(Point* pts, size_t n, float sx, float sy, float cx=0.0f, float cy=0.0f);
+void scale(const Point* in, size_t n, Point* out, float sx, float sy, float cx=0.0f, float cy=0.0f);
+void rotate(Point* pts, size_t n, float angle_deg, float cx=0.0f, float cy=0.0f);
+void rotate(const Point* in, size_t n, Point* out, float angle_deg, float cx=0.0f, float cy=0.0f);
+void shear(Point* pts, size_t n, float shx, float shy, float cx=0.0f, float cy=0.0f);
+void shear(const Point* in, size_t n, Point* out, float shx, float shy, float cx=0.0f, float cy=0.0f);
+void reflectX(Point* pts, size_t n, float cx=0.0f);
+void reflectX(const Point* in, size_t n, Point* out, float cx=0.0f);
+void reflectY(Point* pts, size_t n, float cy=0.0f);
+void reflectY(const Point* in, size_t n, Point* out, float cy=0.0f);
+
+// Uma operação da lista acima, para compose()
+struct PointOp {
+    enum Kind { TRANSLATE, SCALE, ROTATE, SHEAR, REFLECT_X, REFLECT_Y };
+    Kind kind;
+    float a, b;   // dx,dy / sx,sy / ângulo / shx,shy (reflexões não usam)
+    float cx, cy; // centro (translação não usa)
+
+    static PointOp translate(float dx, float dy){ return {TRANSLATE, dx, dy, 0.0f, 0.0f}; }
+    static PointOp scale(float sx, float sy, float cx=0.0f, float cy=0.0f){ return {SCALE, sx, sy, cx, cy}; }
+    static PointOp rotate(float angle_deg, float cx=0.0f, float cy=0.0f){ return {ROTATE, angle_deg, 0.0f, cx, cy}; }
+    static PointOp shear(float shx, float shy, float cx=0.0f, float cy=0.0f){ return {SHEAR, shx, shy, cx, cy}; }
+    static PointOp reflectX(float cx=0.0f){ return {REFLECT_X, 0.0f, 0.0f, cx, 0.0f}; }
+    static PointOp reflectY(float cy=0.0f){ return {REFLECT_Y, 0.0f, 0.0f, 0.0f, cy}; }
+};
+
+// Transformação afim em float: (x,y) -> (a*x + b*y + c, d*x + e*y + f).
+// Pode ser passada diretamente como função de ponto (Shape::transform).
+struct Affine2D {
+    float a, b, c, d, e, f;
+    Point operator()(const Point& p) const {
+        return Point(a * p.first + b * p.second + c, d * p.first + e * p.second + f);
+    }
+};
+
+// ops[0], ops[1], ... compostas (em double) numa só transformação afim
+Affine2D composeAffine(const PointOp* ops, size_t nops);
+Affine2D composeAffine(std::initializer_list<PointOp> ops);
+
+// Aplica ops[0], ops[1], ... numa única passada: as operações são compostas (em
+// double) numa só transformação afim, e cada ponto é lido e escrito uma vez.
+// Difere do encadeamento das funções acima só pelo arredondamento em float.
+void compose(Point* pts, size_t n, const PointOp* ops, size_t nops);
+void compose(const Point* in, size_t n, Point* out, const PointOp* ops, size_t nops);
+void compose(Point* pts, size_t n, std::initializer_list<PointOp> ops);
+std::vector<Point> compose(const std::vector<Point>& pts, std::initializer_list<PointOp> ops);